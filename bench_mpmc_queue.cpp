@@ -0,0 +1,128 @@
+// Producer/consumer benchmark: gp::mpmc_queue against a std::mutex guarded std::deque
+// Both queues are bounded to the same capacity; a full push or an empty pop yields and retries.
+// Build: g++ -std=c++17 -O2 -pthread bench_mpmc_queue.cpp -o bench_mpmc_queue
+// Usage: ./bench_mpmc_queue [producers] [consumers] [items per producer] [capacity]
+#include "gp_mpmc_queue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct item {
+    std::uint64_t pushed_ns;
+    std::uint64_t sequence;
+};
+
+static std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+class mutex_deque {
+public:
+    explicit mutex_deque(std::size_t capacity) : m_capacity(capacity) {}
+
+    bool try_push(const item& value) {
+        std::lock_guard<std::mutex> guard(m_lock);
+        if (m_items.size() == m_capacity) {
+            return false;
+        }
+        m_items.push_back(value);
+        return true;
+    }
+
+    bool try_pop(item& out) {
+        std::lock_guard<std::mutex> guard(m_lock);
+        if (m_items.empty()) {
+            return false;
+        }
+        out = m_items.front();
+        m_items.pop_front();
+        return true;
+    }
+
+private:
+    const std::size_t m_capacity;
+    std::mutex m_lock;
+    std::deque<item> m_items;
+};
+
+struct result {
+    double items_per_second;
+    std::uint64_t latency_p50_ns;
+    std::uint64_t latency_p99_ns;
+};
+
+/// Every consumer records the push-to-pop latency of one item in 64
+template <typename Queue>
+result run(Queue& queue, int producers, int consumers, std::uint64_t items_per_producer) {
+    const std::uint64_t total = items_per_producer * static_cast<std::uint64_t>(producers);
+    std::atomic<std::uint64_t> popped{0};
+    std::vector<std::vector<std::uint64_t>> latencies(consumers);
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&, c] {
+            item value{};
+            while (popped.load(std::memory_order_relaxed) < total) {
+                if (!queue.try_pop(value)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (value.sequence % 64 == 0) {
+                    latencies[c].push_back(now_ns() - value.pushed_ns);
+                }
+                popped.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            for (std::uint64_t i = 0; i < items_per_producer; ++i) {
+                while (!queue.try_push(item{now_ns(), i})) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<std::uint64_t> all;
+    for (const auto& samples : latencies) {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    std::sort(all.begin(), all.end());
+    const auto quantile = [&all](double q) {
+        return all.empty() ? 0 : all[static_cast<std::size_t>(q * static_cast<double>(all.size() - 1))];
+    };
+    return {total / seconds, quantile(0.5), quantile(0.99)};
+}
+
+void print(const char* name, const result& r) {
+    std::printf("%-24s %14.0f items/s  latency p50 %10llu ns  p99 %10llu ns\n", name, r.items_per_second,
+                static_cast<unsigned long long>(r.latency_p50_ns), static_cast<unsigned long long>(r.latency_p99_ns));
+}
+
+int main(int argc, char** argv) {
+    const int producers = argc > 1 ? std::atoi(argv[1]) : 2;
+    const int consumers = argc > 2 ? std::atoi(argv[2]) : 2;
+    const std::uint64_t items = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1000000;
+    const std::size_t capacity = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 1024;
+    std::printf("%d producers, %d consumers, %llu items each, capacity %zu\n", producers, consumers,
+                static_cast<unsigned long long>(items), capacity);
+
+    // mpmc_queue rounds the capacity up to a power of two, the deque gets the same bound
+    gp::mpmc_queue<item> lock_free(capacity);
+    print("gp::mpmc_queue", run(lock_free, producers, consumers, items));
+    mutex_deque locked(lock_free.capacity());
+    print("std::mutex + std::deque", run(locked, producers, consumers, items));
+    return 0;
+}
@@ -0,0 +1,95 @@
+// Read-mostly contention benchmark: gp::shared_spinlock and gp::seqlock against std::shared_mutex
+// Build: g++ -std=c++17 -O2 -pthread bench_shared_spinlock.cpp -o bench_shared_spinlock
+// Usage: ./bench_shared_spinlock [readers] [milliseconds]
+#include "gp_atomic.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+struct payload {
+    std::uint64_t version;
+    std::uint64_t a;
+    std::uint64_t b;
+    std::uint64_t c;
+};
+
+struct result {
+    double reads_per_second;
+    double writes_per_second;
+};
+
+/// Runs readers until the deadline while one writer keeps updating, returns throughputs
+template <typename Read, typename Write>
+result run(int readers, int milliseconds, Read read, Write write) {
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> reads{0};
+    std::uint64_t writes = 0;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < readers; ++i) {
+        threads.emplace_back([&] {
+            std::uint64_t local = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                payload p = read();
+                if (p.a != p.version || p.b != p.version || p.c != p.version) {
+                    std::fprintf(stderr, "torn read\n");
+                    std::abort();
+                }
+                ++local;
+            }
+            reads.fetch_add(local);
+        });
+    }
+    std::thread writer([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            ++writes;
+            write(payload{writes, writes, writes, writes});
+            std::this_thread::yield();
+        }
+    });
+    const auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    stop = true;
+    writer.join();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return {reads.load() / seconds, writes / seconds};
+}
+
+void print(const char* name, const result& r) {
+    std::printf("%-20s %14.0f reads/s %12.0f writes/s\n", name, r.reads_per_second, r.writes_per_second);
+}
+
+int main(int argc, char** argv) {
+    const int readers = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    const int milliseconds = argc > 2 ? std::atoi(argv[2]) : 1000;
+    std::printf("%d readers, 1 writer, %d ms per run\n", readers, milliseconds);
+
+    {
+        std::shared_mutex lock;
+        payload data{};
+        print("std::shared_mutex", run(readers, milliseconds,
+            [&] { std::shared_lock<std::shared_mutex> guard(lock); return data; },
+            [&](const payload& p) { std::unique_lock<std::shared_mutex> guard(lock); data = p; }));
+    }
+    {
+        gp::shared_spinlock lock;
+        payload data{};
+        print("gp::shared_spinlock", run(readers, milliseconds,
+            [&] { std::shared_lock<gp::shared_spinlock> guard(lock); return data; },
+            [&](const payload& p) { std::unique_lock<gp::shared_spinlock> guard(lock); data = p; }));
+    }
+    {
+        gp::seqlock<payload> lock;
+        print("gp::seqlock", run(readers, milliseconds,
+            [&] { return lock.load(); },
+            [&](const payload& p) { lock.store(p); }));
+    }
+    return 0;
+}
@@ -1,32 +1,447 @@
+#ifndef _GP_ATOMIC_H_
+#define _GP_ATOMIC_H_
+
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
 #include <type_traits>
 #include <unordered_map>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifdef GP_CONTENTION_PROFILING
+#include "gp_contention_profiler.h"
+#endif
 
 
 namespace gp {
 
+/// @brief Size used to pad hot atomics apart so they do not share a cache line
+constexpr std::size_t cache_line_size = 64;
+
+/// @brief Hint to the CPU that we are busy waiting
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+/// @brief Test-and-test-and-set spinlock
+/// With GP_CONTENTION_PROFILING a named spinlock reports acquisitions, spins and sampled wait/hold
+/// times to the gp::contention_registry. Without it the name is ignored and nothing is recorded.
 class spinlock {
 public:
+    spinlock() = default;
+
+#ifdef GP_CONTENTION_PROFILING
+    explicit spinlock(const char* name) : m_site(&contention_registry::instance().site(name)) {}
+
+    contention_site* profile_site() const {
+        return m_site;
+    }
+#else
+    explicit spinlock(const char*) {}
+#endif
+
+    void lock() {
+#ifdef GP_CONTENTION_PROFILING
+        if (m_site != nullptr) {
+            profiled_lock();
+            return;
+        }
+#endif
+        while (flag.exchange(true, std::memory_order_acquire)) {
+            while (flag.load(std::memory_order_relaxed)) {
+                cpu_relax(); // Spin on a plain load until the lock looks free
+            }
+        }
+    }
+    bool try_lock() {
+        const bool acquired = !flag.exchange(true, std::memory_order_acquire);
+#ifdef GP_CONTENTION_PROFILING
+        if (m_site != nullptr) {
+            if (acquired) {
+                m_site->record_acquire(0, false, 0);
+            } else {
+                m_site->failed_try_locks.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+#endif
+        return acquired;
+    }
+    void unlock() {
+#ifdef GP_CONTENTION_PROFILING
+        if (m_hold_start != 0) {
+            m_site->record_hold(contention_clock::now() - m_hold_start);
+            m_hold_start = 0;
+        }
+#endif
+        flag.store(false, std::memory_order_release);
+    }
+    /// @brief Plain load, lets waiters poll without pulling the line in exclusive state
+    bool is_locked() const {
+        return flag.load(std::memory_order_relaxed);
+    }
+private:
+#ifdef GP_CONTENTION_PROFILING
+    void profiled_lock() {
+        const bool sampled = contention_clock::sample();
+        const uint64_t start = sampled ? contention_clock::now() : 0;
+        uint64_t spins = 0;
+        while (flag.exchange(true, std::memory_order_acquire)) {
+            while (flag.load(std::memory_order_relaxed)) {
+                ++spins;
+                cpu_relax();
+            }
+        }
+        const uint64_t acquired = sampled ? contention_clock::now() : 0;
+        m_site->record_acquire(spins, sampled, acquired - start);
+        // Only written by the holder, read back by the same holder in unlock()
+        m_hold_start = acquired;
+    }
+
+    contention_site* m_site = nullptr;
+    uint64_t m_hold_start = 0;
+#endif
+    std::atomic<bool> flag{false};
+};
+
+
+/// @brief Reader-writer spinlock (writer preferring)
+/// Readers are counted in per-thread-hashed slots that live on separate cache lines,
+/// so concurrent lock_shared() calls do not bounce a single counter between cores.
+/// A writer raises m_writer first (which holds off new readers) and then waits for every slot to drain.
+/// Satisfies the SharedMutex requirements, so std::shared_lock / std::unique_lock work with it.
+/// @tparam reader_slots Number of distributed reader counters
+template <std::size_t reader_slots = 16>
+class basic_shared_spinlock {
+    static_assert(reader_slots > 0, "basic_shared_spinlock needs at least one reader slot");
+public:
+    basic_shared_spinlock() = default;
+    basic_shared_spinlock(const basic_shared_spinlock&) = delete;
+    basic_shared_spinlock& operator=(const basic_shared_spinlock&) = delete;
+
     void lock() {
-        while (flag.test_and_set(std::memory_order_acquire)) { // Spin until the lock is acquired }
+        bool expected = false;
+        while (!m_writer.compare_exchange_weak(expected, true, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            expected = false;
+            cpu_relax();
+        }
+        for (auto& slot : m_readers) {
+            while (slot.count.load(std::memory_order_seq_cst) != 0) {
+                cpu_relax();
+            }
+        }
     }
+
+    bool try_lock() {
+        bool expected = false;
+        if (!m_writer.compare_exchange_strong(expected, true, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return false;
+        }
+        for (auto& slot : m_readers) {
+            if (slot.count.load(std::memory_order_seq_cst) != 0) {
+                m_writer.store(false, std::memory_order_release);
+                return false;
+            }
+        }
+        return true;
+    }
+
     void unlock() {
-        flag.clear(std::memory_order_release);
+        m_writer.store(false, std::memory_order_release);
+    }
+
+    void lock_shared() {
+        auto& slot = m_readers[this_thread_slot()];
+        for (;;) {
+            while (m_writer.load(std::memory_order_relaxed)) {
+                cpu_relax();
+            }
+            slot.count.fetch_add(1, std::memory_order_seq_cst);
+            if (!m_writer.load(std::memory_order_seq_cst)) {
+                return;
+            }
+            // A writer slipped in between, back off so it is not starved
+            slot.count.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    bool try_lock_shared() {
+        auto& slot = m_readers[this_thread_slot()];
+        if (m_writer.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        slot.count.fetch_add(1, std::memory_order_seq_cst);
+        if (!m_writer.load(std::memory_order_seq_cst)) {
+            return true;
+        }
+        slot.count.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+    void unlock_shared() {
+        m_readers[this_thread_slot()].count.fetch_sub(1, std::memory_order_release);
+    }
+
+private:
+    struct alignas(cache_line_size) reader_slot {
+        std::atomic<std::uint32_t> count{0};
+    };
+
+    static std::size_t this_thread_slot() {
+        static thread_local const std::size_t slot = std::hash<std::thread::id>{}(std::this_thread::get_id()) % reader_slots;
+        return slot;
+    }
+
+    reader_slot m_readers[reader_slots];
+    alignas(cache_line_size) std::atomic<bool> m_writer{false};
+};
+
+using shared_spinlock = basic_shared_spinlock<>;
+
+
+/// @brief Sequence lock for small trivially copyable payloads
+/// Readers never write shared memory: they copy the payload and retry if a writer was active meanwhile.
+/// Writers are serialized with a spinlock and bump the sequence to odd while they update the payload.
+/// The payload is kept in relaxed atomic words, so a torn read is discarded instead of being a data race.
+template <typename T>
+class seqlock {
+    static_assert(std::is_trivially_copyable_v<T>, "seqlock<T> requires a trivially copyable T");
+public:
+    seqlock() : seqlock(T{}) {}
+
+    seqlock(const T& input_data) {
+        write_words(input_data);
+    }
+
+    seqlock(const seqlock&) = delete;
+    seqlock& operator=(const seqlock&) = delete;
+
+    /// @brief Consistent snapshot of the payload, never blocks writers
+    T load() const {
+        for (;;) {
+            const std::uint32_t before = m_sequence.load(std::memory_order_acquire);
+            if (before & 1u) {
+                cpu_relax();
+                continue;
+            }
+            word_type copy[word_count];
+            for (std::size_t i = 0; i < word_count; ++i) {
+                copy[i] = m_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_sequence.load(std::memory_order_relaxed) == before) {
+                T result;
+                std::memcpy(static_cast<void*>(&result), copy, sizeof(T));
+                return result;
+            }
+        }
+    }
+
+    void store(const T& input) {
+        m_writer_lock.lock();
+        const std::uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        write_words(input);
+        m_sequence.store(sequence + 2, std::memory_order_release);
+        m_writer_lock.unlock();
+    }
+
+    /// @brief Read-modify-write of the payload under the writer lock
+    template <typename Fn>
+    void update(Fn&& fn) {
+        m_writer_lock.lock();
+        T value = read_words();
+        fn(value);
+        const std::uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        write_words(value);
+        m_sequence.store(sequence + 2, std::memory_order_release);
+        m_writer_lock.unlock();
+    }
+
+private:
+    using word_type = std::uintptr_t;
+    static constexpr std::size_t word_count = (sizeof(T) + sizeof(word_type) - 1) / sizeof(word_type);
+
+    T read_words() const {
+        word_type copy[word_count];
+        for (std::size_t i = 0; i < word_count; ++i) {
+            copy[i] = m_words[i].load(std::memory_order_relaxed);
+        }
+        T result;
+        std::memcpy(static_cast<void*>(&result), copy, sizeof(T));
+        return result;
+    }
+
+    void write_words(const T& input) {
+        word_type copy[word_count] = {};
+        std::memcpy(copy, &input, sizeof(T));
+        for (std::size_t i = 0; i < word_count; ++i) {
+            m_words[i].store(copy[i], std::memory_order_relaxed);
+        }
     }
+
+    std::atomic<std::uint32_t> m_sequence{0};
+    std::atomic<word_type> m_words[word_count];
+    spinlock m_writer_lock;
+};
+
+
+namespace detail {
+
+/// @brief Types for which fetch_add / fetch_sub / fetch_min / fetch_max make sense
+template <typename T>
+constexpr bool is_atomic_arithmetic_v = (std::is_integral_v<T> && !std::is_same_v<T, bool>) || std::is_floating_point_v<T>;
+
+/// @brief Types for which fetch_or / fetch_and / fetch_xor make sense
+template <typename T>
+constexpr bool is_atomic_bitwise_v = std::is_integral_v<T> && !std::is_same_v<T, bool>;
+
+/// @brief Value equality for scalars, bitwise equality for everything else
+template <typename T>
+bool bitwise_equal(const T& lhs, const T& rhs) {
+    if constexpr (std::is_scalar_v<T>) {
+        return lhs == rhs;
+    } else {
+        return std::memcmp(&lhs, &rhs, sizeof(T)) == 0;
+    }
+}
+
+/// @brief Storage backing gp::atomic<T>
+/// The generic case is std::atomic<T>, which is lock-free for scalars and pointers and
+/// falls back to the compiler runtime (libatomic, usually a lock table) for other sizes.
+template <typename T, typename = void>
+class atomic_storage {
+public:
+    static constexpr bool has_native_rmw = is_atomic_bitwise_v<T> || std::is_pointer_v<T>;
+
+    atomic_storage(const T& input_data) : m_data(input_data) {}
+
+    T load() const { return m_data.load(); }
+    void store(const T& input) { m_data.store(input); }
+    T exchange(const T& input) { return m_data.exchange(input); }
+    bool compare_exchange(T& expected, const T& desired) { return m_data.compare_exchange_strong(expected, desired); }
+    bool is_lock_free() const { return m_data.is_lock_free(); }
+
+    std::atomic<T>& native() { return m_data; }
+
 private:
-    std::atomic_flag flag = ATOMIC_FLAG_INIT;
+    std::atomic<T> m_data;
 };
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define GP_ATOMIC_NATIVE_DWCAS 1
+inline bool dwcas(volatile std::uint64_t* dst, std::uint64_t expected[2], const std::uint64_t desired[2]) {
+    bool swapped;
+    __asm__ __volatile__("lock cmpxchg16b %1\n\tsete %0"
+                         : "=q"(swapped), "+m"(*reinterpret_cast<volatile __int128*>(dst)),
+                           "+a"(expected[0]), "+d"(expected[1])
+                         : "b"(desired[0]), "c"(desired[1])
+                         : "cc", "memory");
+    return swapped;
+}
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define GP_ATOMIC_NATIVE_DWCAS 1
+inline bool dwcas(volatile std::uint64_t* dst, std::uint64_t expected[2], const std::uint64_t desired[2]) {
+    return _InterlockedCompareExchange128(reinterpret_cast<volatile long long*>(dst),
+                                          static_cast<long long>(desired[1]), static_cast<long long>(desired[0]),
+                                          reinterpret_cast<long long*>(expected)) != 0;
+}
+#endif
+
+#ifdef GP_ATOMIC_NATIVE_DWCAS
+/// @brief 16 byte storage driven directly by cmpxchg16b (x86-64 only)
+/// Every operation, including load, is a locked double-width CAS, so it is lock-free
+/// without linking libatomic. CPUs lacking cmpxchg16b (first generation AMD64) are not supported.
+/// On other targets 16 byte types use the generic std::atomic<T> storage above.
+template <typename T>
+class atomic_storage<T, std::enable_if_t<sizeof(T) == 16>> {
+public:
+    static constexpr bool has_native_rmw = false;
+
+    atomic_storage(const T& input_data) {
+        std::uint64_t words[2];
+        std::memcpy(words, &input_data, sizeof(T));
+        m_words[0] = words[0];
+        m_words[1] = words[1];
+    }
+
+    T load() const {
+        std::uint64_t expected[2] = {0, 0};
+        const std::uint64_t desired[2] = {0, 0};
+        dwcas(const_cast<volatile std::uint64_t*>(m_words), expected, desired);
+        return from_words(expected);
+    }
+
+    void store(const T& input) {
+        exchange(input);
+    }
+
+    T exchange(const T& input) {
+        std::uint64_t expected[2] = {m_words[0], m_words[1]};
+        std::uint64_t desired[2];
+        std::memcpy(desired, &input, sizeof(T));
+        while (!dwcas(m_words, expected, desired)) { }
+        return from_words(expected);
+    }
+
+    bool compare_exchange(T& expected, const T& desired) {
+        std::uint64_t expected_words[2];
+        std::uint64_t desired_words[2];
+        std::memcpy(expected_words, &expected, sizeof(T));
+        std::memcpy(desired_words, &desired, sizeof(T));
+        if (dwcas(m_words, expected_words, desired_words)) {
+            return true;
+        }
+        std::memcpy(static_cast<void*>(&expected), expected_words, sizeof(T));
+        return false;
+    }
+
+    bool is_lock_free() const { return true; }
+
+private:
+    static T from_words(const std::uint64_t words[2]) {
+        T result;
+        std::memcpy(static_cast<void*>(&result), words, sizeof(T));
+        return result;
+    }
+
+    alignas(16) volatile std::uint64_t m_words[2];
+};
+#endif
 
+} // namespace detail
+
+
+/// @brief CRTP interface shared by gp::atomic and gp::semi_atomic
+/// T may be any trivially copyable type. Comparisons in compare_exchange are bitwise, like std::atomic.
+/// Arithmetic members only exist for integral/floating T, bitwise members only for integral T.
 template<typename T, typename DerivedClass>
 class atomic_interface_base {
-    static_assert(
-        std::is_same_v<T, uint8_t>  || std::is_same_v<T, uint16_t> || std::is_same_v<T, uint32_t> ||
-        std::is_same_v<T, uint64_t> || std::is_same_v<T, int>      || std::is_same_v<T, float>    ||
-        std::is_same_v<T, double>   || std::is_same_v<T, bool>     || std::is_same_v<T, char>     || 
-        std::is_same_v<T, std::byte>,
-        "T must be one of the specified base data types (uint8_t, uint16_t, uint32_t, uint64_t, int, float, double, bool, char, or std::byte)"
-    );
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+    template <typename U>
+    using enable_if_arithmetic = std::enable_if_t<detail::is_atomic_arithmetic_v<U>, int>;
+
+    template <typename U>
+    using enable_if_bitwise = std::enable_if_t<detail::is_atomic_bitwise_v<U>, int>;
+
 public:
     T load() {
         return static_cast<DerivedClass*>(this)->load_impl();
@@ -36,66 +451,128 @@ public:
         static_cast<DerivedClass*>(this)->store_impl(input);
     }
 
+    T exchange(const T& input) {
+        return static_cast<DerivedClass*>(this)->exchange_impl(input);
+    }
+
+    bool compare_exchange(T& expected, const T& desired) {
+        return static_cast<DerivedClass*>(this)->compare_exchange_impl(expected, desired);
+    }
+
+    /// @brief Atomically replaces the value with fn(old) using a CAS loop, returns the old value
+    template <typename Fn>
+    T fetch_update(Fn&& fn) {
+        T expected = load();
+        while (!compare_exchange(expected, fn(expected))) { }
+        return expected;
+    }
+
+    template <typename U = T, enable_if_arithmetic<U> = 0>
     T fetch_add(const T& value) {
         return static_cast<DerivedClass*>(this)->fetch_add_impl(value);
     }
 
+    template <typename U = T, enable_if_arithmetic<U> = 0>
     T fetch_sub(const T& value) {
         return static_cast<DerivedClass*>(this)->fetch_sub_impl(value);
     }
 
-    bool compare_exchange(T& expected, const T& desired) {
-        return static_cast<DerivedClass*>(this)->compare_exchange_impl(expected, desired);
+    template <typename U = T, enable_if_arithmetic<U> = 0>
+    T fetch_min(const T& value) {
+        return fetch_update([&value](const T& current) { return value < current ? value : current; });
+    }
+
+    template <typename U = T, enable_if_arithmetic<U> = 0>
+    T fetch_max(const T& value) {
+        return fetch_update([&value](const T& current) { return current < value ? value : current; });
     }
 
+    template <typename U = T, enable_if_bitwise<U> = 0>
+    T fetch_or(const T& value) {
+        return static_cast<DerivedClass*>(this)->fetch_or_impl(value);
+    }
+
+    template <typename U = T, enable_if_bitwise<U> = 0>
+    T fetch_and(const T& value) {
+        return static_cast<DerivedClass*>(this)->fetch_and_impl(value);
+    }
+
+    template <typename U = T, enable_if_bitwise<U> = 0>
+    T fetch_xor(const T& value) {
+        return static_cast<DerivedClass*>(this)->fetch_xor_impl(value);
+    }
+
+    template <typename U = T, enable_if_arithmetic<U> = 0>
     T operator+ (const T& value) {
         return fetch_add(value);
     }
 
+    template <typename U = T, enable_if_arithmetic<U> = 0>
     T operator- (const T& value) {
         return fetch_sub(value);
     }
 
+    template <typename U = T, enable_if_arithmetic<U> = 0>
     T operator+= (const T& value) {
         return fetch_add(value);
     }
 
+    template <typename U = T, enable_if_arithmetic<U> = 0>
     T operator-= (const T& value) {
         return fetch_sub(value);
     }
 
+    template <typename U = T, enable_if_arithmetic<U> = 0>
     T operator++(int) {
         return fetch_add(1);
     }
 
+    template <typename U = T, enable_if_arithmetic<U> = 0>
     T operator--(int) {
         return fetch_sub(1);
     }
 
-
+    template <typename U = T, enable_if_arithmetic<U> = 0>
     T operator* (const T& value) {
         return load() * value;
     }
 
+    template <typename U = T, enable_if_arithmetic<U> = 0>
     T operator/ (const T& value) {
         return load() / value;
     }
-    
+
+    /// Prefix forms return the updated value
+    template <typename U = T, enable_if_arithmetic<U> = 0>
     T operator++() {
-        return fetch_add(1);
+        return fetch_add(1) + T(1);
     }
 
+    template <typename U = T, enable_if_arithmetic<U> = 0>
     T operator--() {
-        return fetch_sub(1);
+        return fetch_sub(1) - T(1);
     }
 };
 
+/// @brief Lock-free (where the platform allows) atomic for any trivially copyable T
+/// With GP_CONTENTION_PROFILING an atomic constructed with a name reports compare_exchange
+/// attempts and failures (fetch_update loops included) to the gp::contention_registry.
 template <typename T>
 class atomic : public atomic_interface_base<T, atomic<T>> {
 public:
-    atomic(const T& input_data) : m_atomic_data(input_data) {}
+    atomic(const T& input_data = T()) : m_atomic_data(input_data) {}
 
-    atomic(const atomic& other) : m_atomic_data(other.m_atomic_data.load()) {}
+#ifdef GP_CONTENTION_PROFILING
+    atomic(const T& input_data, const char* name) : m_atomic_data(input_data), m_site(&contention_registry::instance().site(name)) {}
+#else
+    atomic(const T& input_data, const char*) : m_atomic_data(input_data) {}
+#endif
+
+    atomic(const atomic& other) : m_atomic_data(other.m_atomic_data.load()) {
+#ifdef GP_CONTENTION_PROFILING
+        m_site = other.m_site;
+#endif
+    }
 
     atomic& operator=(const atomic& other) {
         m_atomic_data.store(other.m_atomic_data.load());
@@ -103,7 +580,7 @@ public:
     }
 
     bool operator==(const atomic& other) const {
-        return m_atomic_data.load() == other.m_atomic_data.load();
+        return detail::bitwise_equal(m_atomic_data.load(), other.m_atomic_data.load());
     }
 
     bool operator!=(const atomic& other) const {
@@ -111,10 +588,16 @@ public:
     }
     
     bool operator==(const T& other) const {
-        return m_atomic_data.load() == other;
+        return detail::bitwise_equal(m_atomic_data.load(), other);
+    }
+
+    bool is_lock_free() const {
+        return m_atomic_data.is_lock_free();
     }
 
 private:
+    using storage_type = detail::atomic_storage<T>;
+
     T load_impl() {
         return m_atomic_data.load();
     }
@@ -123,27 +606,79 @@ private:
         m_atomic_data.store(input);
     }
 
+    T exchange_impl(const T& input) {
+        return m_atomic_data.exchange(input);
+    }
+
     T fetch_add_impl(const T& value) {
-        return m_atomic_data.fetch_add(value);
+        if constexpr (storage_type::has_native_rmw) {
+            return m_atomic_data.native().fetch_add(value);
+        } else {
+            return this->fetch_update([&value](const T& current) { return static_cast<T>(current + value); });
+        }
     }
 
     T fetch_sub_impl(const T& value) {
-        return m_atomic_data.fetch_sub(value);
+        if constexpr (storage_type::has_native_rmw) {
+            return m_atomic_data.native().fetch_sub(value);
+        } else {
+            return this->fetch_update([&value](const T& current) { return static_cast<T>(current - value); });
+        }
+    }
+
+    T fetch_or_impl(const T& value) {
+        if constexpr (storage_type::has_native_rmw) {
+            return m_atomic_data.native().fetch_or(value);
+        } else {
+            return this->fetch_update([&value](const T& current) { return static_cast<T>(current | value); });
+        }
+    }
+
+    T fetch_and_impl(const T& value) {
+        if constexpr (storage_type::has_native_rmw) {
+            return m_atomic_data.native().fetch_and(value);
+        } else {
+            return this->fetch_update([&value](const T& current) { return static_cast<T>(current & value); });
+        }
+    }
+
+    T fetch_xor_impl(const T& value) {
+        if constexpr (storage_type::has_native_rmw) {
+            return m_atomic_data.native().fetch_xor(value);
+        } else {
+            return this->fetch_update([&value](const T& current) { return static_cast<T>(current ^ value); });
+        }
     }
 
     bool compare_exchange_impl(T& expected, const T& desired) {
-        return m_atomic_data.compare_exchange_strong(expected, desired);
+#ifdef GP_CONTENTION_PROFILING
+        const bool exchanged = m_atomic_data.compare_exchange(expected, desired);
+        if (m_site != nullptr) {
+            m_site->record_cas(exchanged);
+        }
+        return exchanged;
+#else
+        return m_atomic_data.compare_exchange(expected, desired);
+#endif
     }
 
-    std::atomic<T> m_atomic_data;
+    storage_type m_atomic_data;
+#ifdef GP_CONTENTION_PROFILING
+    contention_site* m_site = nullptr;
+#endif
     friend class atomic_interface_base<T, atomic<T>>;
 };
 
+/// @brief Spinlock guarded value for any trivially copyable T
+/// A name (profiled with GP_CONTENTION_PROFILING, ignored otherwise) is given to the inner spinlock,
+/// compare_exchange attempts and failures are reported under the same name.
 template <typename T>
 class semi_atomic : public atomic_interface_base<T, semi_atomic<T>> {
 public:
     semi_atomic(const T& input_data) : m_data_object(input_data) { }
 
+    semi_atomic(const T& input_data, const char* name) : m_data_object(input_data), m_spinlock(name) { }
+
     semi_atomic(const semi_atomic& other) : m_data_object(other.m_data_object) {}
 
     semi_atomic& operator=(const semi_atomic& other) {
@@ -164,7 +699,7 @@ public:
     }
     
     atomic<T> convert_to_atomic() {
-        return atomic_interface_base<T, atomic<T>>(m_data_object);
+        return atomic<T>(m_data_object);
     }
 
     /// Cast to atomic
@@ -181,30 +716,55 @@ private:
         m_data_object = input;
     }
 
-    T& fetch_add_impl(const T& value) {
+    /// Applies fn to the value under the spinlock and returns the previous value
+    template <typename Fn>
+    T locked_update(Fn&& fn) {
         m_spinlock.lock();
-        m_data_object += value;
+        T previous = m_data_object;
+        m_data_object = fn(previous);
         m_spinlock.unlock();
-        return m_data_object;
+        return previous;
     }
 
-    T& fetch_sub_impl(const T& value) {
-        m_spinlock.lock();
-        m_data_object -= value;
-        m_spinlock.unlock();
-        return m_data_object;
+    T exchange_impl(const T& input) {
+        return locked_update([&input](const T&) { return input; });
+    }
+
+    T fetch_add_impl(const T& value) {
+        return locked_update([&value](const T& current) { return static_cast<T>(current + value); });
+    }
+
+    T fetch_sub_impl(const T& value) {
+        return locked_update([&value](const T& current) { return static_cast<T>(current - value); });
+    }
+
+    T fetch_or_impl(const T& value) {
+        return locked_update([&value](const T& current) { return static_cast<T>(current | value); });
+    }
+
+    T fetch_and_impl(const T& value) {
+        return locked_update([&value](const T& current) { return static_cast<T>(current & value); });
+    }
+
+    T fetch_xor_impl(const T& value) {
+        return locked_update([&value](const T& current) { return static_cast<T>(current ^ value); });
     }
 
     bool compare_exchange_impl(T& expected, const T& desired) {
         m_spinlock.lock();
-        if (m_data_object == expected) {
+        const bool exchanged = detail::bitwise_equal(m_data_object, expected);
+        if (exchanged) {
             m_data_object = desired;
-            m_spinlock.unlock();
-            return true;
+        } else {
+            expected = m_data_object;
         }
-        expected = m_data_object;
         m_spinlock.unlock();
-        return false;
+#ifdef GP_CONTENTION_PROFILING
+        if (contention_site* site = m_spinlock.profile_site()) {
+            site->record_cas(exchanged);
+        }
+#endif
+        return exchanged;
     }
 
     T m_data_object;
@@ -212,4 +772,182 @@ private:
     friend class atomic_interface_base<T, semi_atomic<T>>;
 };
 
+
+/// @brief Flat-combining wrapper for objects of any type
+/// Each caller publishes its operation in a per-thread slot; whichever thread wins the spinlock
+/// runs every pending operation in one pass, so the object stays in the combiner's cache
+/// instead of bouncing between cores on every call. An uncontended call finds the lock free and
+/// simply runs under it. Slots are handed out per live thread and recycled at thread exit, a
+/// combining pass only scans the slots handed out so far. Threads beyond the first
+/// publication_slots live ones get no slot and fall back to plain locking.
+/// Operations must not call back into the same flat_combining object.
+/// @tparam T The wrapped object (no restrictions)
+/// @tparam publication_slots Number of publication records
+template <typename T, std::size_t publication_slots = 64>
+class flat_combining {
+public:
+    template <typename... Args>
+    flat_combining(Args&&... args) : m_data_object(std::forward<Args>(args)...) {}
+
+    flat_combining(const flat_combining&) = delete;
+    flat_combining& operator=(const flat_combining&) = delete;
+
+    /// @brief Applies op(T&) to the object and returns its result
+    /// Exceptions thrown by op are rethrown in the calling thread. A reference result is passed
+    /// through as is; using it after apply() returns is no longer serialized with other ops.
+    template <typename Fn>
+    auto apply(Fn&& op) -> std::invoke_result_t<Fn&, T&> {
+        using result_type = std::invoke_result_t<Fn&, T&>;
+        if constexpr (std::is_void_v<result_type>) {
+            auto task = [&op](T& object) { op(object); };
+            execute(task);
+        } else if constexpr (std::is_reference_v<result_type>) {
+            std::remove_reference_t<result_type>* result = nullptr;
+            auto task = [&op, &result](T& object) {
+                result_type bound = op(object);
+                result = std::addressof(bound);
+            };
+            execute(task);
+            return static_cast<result_type>(*result);
+        } else {
+            std::optional<result_type> result;
+            auto task = [&op, &result](T& object) { result.emplace(op(object)); };
+            execute(task);
+            return std::move(*result);
+        }
+    }
+
+    /// @brief Copy of the object taken inside a combining pass
+    T load() {
+        return apply([](T& object) { return object; });
+    }
+
+    void store(const T& input) {
+        apply([&input](T& object) { object = input; });
+    }
+
+private:
+    struct operation_record {
+        void (*invoke)(void* context, T& object);
+        void* context;
+        std::exception_ptr error;
+        std::atomic<bool> done{false};
+    };
+
+    struct alignas(cache_line_size) publication_slot {
+        std::atomic<operation_record*> pending{nullptr};
+    };
+
+    template <typename Task>
+    void execute(Task& task) {
+        operation_record record;
+        record.invoke = [](void* context, T& object) { (*static_cast<Task*>(context))(object); };
+        record.context = &task;
+
+        const std::size_t slot_index = this_thread_slot();
+        if (slot_index == no_slot || (!m_spinlock.is_locked() && m_spinlock.try_lock())) {
+            // Uncontended (or no slot of our own): run under the lock and serve whoever published
+            if (slot_index == no_slot) {
+                m_spinlock.lock();
+            }
+            run(record);
+            combine();
+            m_spinlock.unlock();
+        } else {
+            m_slots[slot_index].pending.store(&record, std::memory_order_release);
+            while (!record.done.load(std::memory_order_acquire)) {
+                // Only go for the lock line once a plain load saw it free
+                if (!m_spinlock.is_locked() && m_spinlock.try_lock()) {
+                    combine();
+                    m_spinlock.unlock();
+                } else {
+                    cpu_relax();
+                }
+            }
+        }
+        if (record.error) {
+            std::rethrow_exception(record.error);
+        }
+    }
+
+    void run(operation_record& record) {
+        try {
+            record.invoke(record.context, m_data_object);
+        } catch (...) {
+            record.error = std::current_exception();
+        }
+    }
+
+    /// Runs every published operation, must hold m_spinlock
+    void combine() {
+        const std::size_t used = slot_registry().in_use.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < used; ++i) {
+            publication_slot& slot = m_slots[i];
+            operation_record* record = slot.pending.load(std::memory_order_acquire);
+            if (record == nullptr) {
+                continue;
+            }
+            run(*record);
+            slot.pending.store(nullptr, std::memory_order_relaxed);
+            // The record lives on the publisher's stack, do not touch it after this
+            record->done.store(true, std::memory_order_release);
+        }
+    }
+
+    static constexpr std::size_t no_slot = publication_slots;
+
+    /// Slot indices of the live threads, shared by every flat_combining of this type
+    struct slot_table {
+        spinlock lock;
+        std::vector<std::size_t> free_slots;
+        /// Highest index handed out + 1, bounds the combining scan
+        std::atomic<std::size_t> in_use{0};
+    };
+
+    static slot_table& slot_registry() {
+        static slot_table table;
+        return table;
+    }
+
+    struct slot_holder {
+        std::size_t index = no_slot;
+
+        slot_holder() {
+            slot_table& table = slot_registry();
+            table.lock.lock();
+            if (!table.free_slots.empty()) {
+                // Lowest recycled index keeps the scanned prefix short
+                auto lowest = std::min_element(table.free_slots.begin(), table.free_slots.end());
+                index = *lowest;
+                table.free_slots.erase(lowest);
+            } else if (table.in_use.load(std::memory_order_relaxed) < publication_slots) {
+                index = table.in_use.load(std::memory_order_relaxed);
+                table.in_use.store(index + 1, std::memory_order_release);
+            }
+            table.lock.unlock();
+        }
+
+        ~slot_holder() {
+            if (index == no_slot) {
+                return;
+            }
+            slot_table& table = slot_registry();
+            table.lock.lock();
+            table.free_slots.push_back(index);
+            table.lock.unlock();
+        }
+    };
+
+    static std::size_t this_thread_slot() {
+        static thread_local slot_holder holder;
+        return holder.index;
+    }
+
+    publication_slot m_slots[publication_slots];
+    spinlock m_spinlock;
+    T m_data_object;
+};
+
 } // namespace gp
+
+#endif
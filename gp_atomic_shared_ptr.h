@@ -0,0 +1,142 @@
+#ifndef _GP_ATOMIC_SHARED_PTR_H_
+#define _GP_ATOMIC_SHARED_PTR_H_
+
+#include <atomic>
+#include <type_traits>
+#include <utility>
+#include "gp_shared_ptr.h"
+#include "gp_hazard_allocator.h"
+
+namespace gp {
+
+   /// @brief Shared pointer that can be loaded and replaced concurrently (RCU style publication)
+   /// The atomic holds one counted reference to the published control block. Readers protect the
+   /// block with a hazard pointer before taking their own reference, so load() never locks and
+   /// never touches a block that could already be freed. A replaced block's reference is handed to
+   /// the HazardPointerDomain and only dropped (through memory_manager) once no reader still
+   /// protects it. Every replacement scans right away: writers are expected to be rare, and a
+   /// single writer publishing large values must not wait for the domain's scan threshold.
+   /// @tparam T The type of the data
+   /// @tparam ref_counter A thread safe reference counter (atomic(default), semi_atomic, biased_ref_counter)
+   /// @tparam memory_manager The memory manager type applied when the last reference goes away
+   template <typename T, typename ref_counter = atomic<uint32_t>, template<typename> typename memory_manager = deleter>
+   class atomic_shared_ptr
+   {
+      public:
+      using value_type = shared_ptr<T, ref_counter, memory_manager>;
+
+      static_assert(!std::is_arithmetic_v<ref_counter>, "atomic_shared_ptr needs a thread safe ref_counter");
+
+      atomic_shared_ptr() noexcept : m_block(nullptr) {}
+      atomic_shared_ptr(value_type desired) noexcept : m_block(take(desired)) {}
+
+      atomic_shared_ptr(const atomic_shared_ptr&) = delete;
+      atomic_shared_ptr& operator=(const atomic_shared_ptr&) = delete;
+
+      /// Nobody can be reading concurrently anymore, the reference is dropped right away
+     ~atomic_shared_ptr()
+      {
+         release_reference(m_block.load(std::memory_order_acquire), nullptr);
+      }
+
+      /// @brief A new reference to the published value (empty if nothing is published)
+      value_type load() const
+      {
+         HazardPointer hazard;
+         block_type* block = hazard.protect(m_block);
+         if(block != nullptr)
+         {
+            // Still published or at least not yet released by the hazard domain: the count is > 0
+            counter_ops::increment(block->ref_count);
+         }
+         return value_type(block);
+      }
+
+      /// @brief Publish desired, the previous value is released once no reader protects it
+      void store(value_type desired)
+      {
+         retire(m_block.exchange(take(desired), std::memory_order_acq_rel));
+      }
+
+      /// @brief Publish desired and return the previous value
+      value_type exchange(value_type desired)
+      {
+         block_type* previous = m_block.exchange(take(desired), std::memory_order_acq_rel);
+         if(previous == nullptr)
+         {
+            return value_type(previous);
+         }
+         // The caller gets its own reference, the atomic's one still waits for the readers
+         counter_ops::increment(previous->ref_count);
+         retire(previous);
+         return value_type(previous);
+      }
+
+      /// @brief Publish desired if expected is still the published value
+      /// On failure expected is reloaded with the currently published value.
+      bool compare_exchange(value_type& expected, value_type desired)
+      {
+         block_type* current = expected.cb;
+         if(m_block.compare_exchange_strong(current, desired.cb, std::memory_order_acq_rel, std::memory_order_acquire))
+         {
+            take(desired);
+            retire(current);
+            return true;
+         }
+         expected = load();
+         return false;
+      }
+
+      operator value_type() const
+      {
+         return load();
+      }
+
+      atomic_shared_ptr& operator=(value_type desired)
+      {
+         store(std::move(desired));
+         return *this;
+      }
+
+      bool is_lock_free() const
+      {
+         return m_block.is_lock_free();
+      }
+
+      private:
+      using block_type = control_block<T, ref_counter>;
+      using counter_ops = ref_count_ops<ref_counter>;
+
+      /// Moves the reference held by value into the atomic
+      static block_type* take(value_type& value) noexcept
+      {
+         block_type* block = value.cb;
+         value.cb = nullptr;
+         return block;
+      }
+
+      static void retire(block_type* block)
+      {
+         if(block != nullptr)
+         {
+            HazardPointerDomain& domain = HazardPointerDomain::instance();
+            domain.retire(block, &atomic_shared_ptr::release_reference);
+            domain.scan();
+         }
+      }
+
+      static void release_reference(void* pointer, void*)
+      {
+         auto* block = static_cast<block_type*>(pointer);
+         if(block != nullptr && counter_ops::decrement(block->ref_count))
+         {
+            memory_manager<block_type>::retire(block);
+         }
+      }
+
+      std::atomic<block_type*> m_block;
+   };
+
+} // namespace gp
+
+#endif
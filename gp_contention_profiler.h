@@ -0,0 +1,276 @@
+#ifndef _GP_CONTENTION_PROFILER_H_
+#define _GP_CONTENTION_PROFILER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifndef GP_CONTENTION_SAMPLE_RATE
+#define GP_CONTENTION_SAMPLE_RATE 64
+#endif
+
+namespace gp {
+
+/// @brief Cheap timestamp used for the sampled timings (rdtsc on x86, steady_clock ns elsewhere)
+struct contention_clock {
+    static uint64_t now() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /// True with probability 1/GP_CONTENTION_SAMPLE_RATE
+    /// Draws from a per-thread xorshift generator rather than counting calls, so a loop that
+    /// touches several instrumented sites in a fixed pattern still samples each of them.
+    static bool sample() {
+        static thread_local uint32_t state = seed();
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state % GP_CONTENTION_SAMPLE_RATE == 0;
+    }
+
+private:
+    /// Distinct per thread and never 0 (a fixed point of xorshift)
+    static uint32_t seed() {
+        static std::atomic<uint32_t> threads{0};
+        const uint32_t seed = (threads.fetch_add(1, std::memory_order_relaxed) + 1) * 0x9E3779B9u;
+        return seed != 0 ? seed : 1;
+    }
+};
+
+/// @brief Log2 histogram of tick counts, bucket i holds values in [2^(i-1), 2^i)
+struct contention_histogram {
+    static constexpr std::size_t buckets = 40;
+
+    std::atomic<uint64_t> counts[buckets] = {};
+
+    void record(uint64_t ticks) {
+        std::size_t bucket = 0;
+        while (ticks != 0 && bucket + 1 < buckets) {
+            ticks >>= 1;
+            ++bucket;
+        }
+        counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t total() const {
+        uint64_t total = 0;
+        for (const auto& count : counts) {
+            total += count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    /// Upper bound of the bucket holding the given quantile, 0 without samples
+    uint64_t quantile(double q) const {
+        const uint64_t total = this->total();
+        if (total == 0) {
+            return 0;
+        }
+        const uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < buckets; ++i) {
+            seen += counts[i].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                return uint64_t(1) << i;
+            }
+        }
+        return uint64_t(1) << (buckets - 1);
+    }
+
+    void reset() {
+        for (auto& count : counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+/// @brief Counters shared by every instrumented primitive registered under one name
+struct contention_site {
+    std::string name;
+    std::atomic<uint64_t> acquisitions{0};
+    std::atomic<uint64_t> contended_acquisitions{0};
+    std::atomic<uint64_t> failed_try_locks{0};
+    std::atomic<uint64_t> spin_iterations{0};
+    std::atomic<uint64_t> cas_attempts{0};
+    std::atomic<uint64_t> cas_failures{0};
+    std::atomic<uint64_t> sampled_wait_ticks{0};
+    std::atomic<uint64_t> sampled_hold_ticks{0};
+    /// Spins of the sampled acquisitions, relates spins to wait time for unsampled sites
+    std::atomic<uint64_t> sampled_spin_iterations{0};
+    contention_histogram wait_ticks;
+    contention_histogram hold_ticks;
+
+    explicit contention_site(std::string site_name) : name(std::move(site_name)) {}
+
+    void record_acquire(uint64_t spins, bool sampled, uint64_t wait) {
+        acquisitions.fetch_add(1, std::memory_order_relaxed);
+        if (spins != 0) {
+            contended_acquisitions.fetch_add(1, std::memory_order_relaxed);
+            spin_iterations.fetch_add(spins, std::memory_order_relaxed);
+        }
+        if (sampled) {
+            sampled_wait_ticks.fetch_add(wait, std::memory_order_relaxed);
+            sampled_spin_iterations.fetch_add(spins, std::memory_order_relaxed);
+            wait_ticks.record(wait);
+        }
+    }
+
+    void record_hold(uint64_t hold) {
+        sampled_hold_ticks.fetch_add(hold, std::memory_order_relaxed);
+        hold_ticks.record(hold);
+    }
+
+    void record_cas(bool succeeded) {
+        cas_attempts.fetch_add(1, std::memory_order_relaxed);
+        if (!succeeded) {
+            cas_failures.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void reset() {
+        for (auto* counter : {&acquisitions, &contended_acquisitions, &failed_try_locks, &spin_iterations,
+                              &cas_attempts, &cas_failures, &sampled_wait_ticks, &sampled_hold_ticks,
+                              &sampled_spin_iterations}) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+        wait_ticks.reset();
+        hold_ticks.reset();
+    }
+};
+
+/// @brief Process wide table of contention sites, keyed by the names given to the primitives
+/// Instances constructed with the same name share one site. report() ranks sites by their
+/// estimated total wait (sampled wait scaled by the sample rate), so the hot spot comes first.
+/// A site without timing samples is estimated from its spin count, at the ticks per spin
+/// measured over all sampled acquisitions (one tick per spin if nothing was sampled yet).
+/// Ticks are converted to nanoseconds with a rate measured between registry creation and the report.
+class contention_registry {
+public:
+    static contention_registry& instance() {
+        static contention_registry registry;
+        return registry;
+    }
+
+    /// @brief Site for name, created on first use; the reference stays valid for the process
+    contention_site& site(const char* name) {
+        std::lock_guard<std::mutex> guard(m_lock);
+        auto found = m_index.find(name);
+        if (found != m_index.end()) {
+            return *found->second;
+        }
+        m_sites.emplace_back(name);
+        m_index.emplace(m_sites.back().name, &m_sites.back());
+        return m_sites.back();
+    }
+
+    /// @brief Zero every site, e.g. after warm up
+    void reset() {
+        std::lock_guard<std::mutex> guard(m_lock);
+        for (auto& site : m_sites) {
+            site.reset();
+        }
+    }
+
+    /// @brief Ranked plain text table, top limits the rows (0 = all)
+    std::string report(std::size_t top = 0) {
+        const double ns_per_tick = nanoseconds_per_tick();
+        std::lock_guard<std::mutex> guard(m_lock);
+        uint64_t all_sampled_wait = 0;
+        uint64_t all_sampled_spins = 0;
+        for (const auto& site : m_sites) {
+            all_sampled_wait += site.sampled_wait_ticks.load(std::memory_order_relaxed);
+            all_sampled_spins += site.sampled_spin_iterations.load(std::memory_order_relaxed);
+        }
+        const double ticks_per_spin = all_sampled_spins == 0 ? 1.0 : static_cast<double>(all_sampled_wait) / static_cast<double>(all_sampled_spins);
+
+        struct ranked_site {
+            const contention_site* site;
+            double wait_ticks;
+            uint64_t conflicts;
+        };
+        std::vector<ranked_site> ranked;
+        for (const auto& site : m_sites) {
+            const double wait = site.wait_ticks.total() != 0
+                ? static_cast<double>(site.sampled_wait_ticks.load(std::memory_order_relaxed)) * GP_CONTENTION_SAMPLE_RATE
+                : static_cast<double>(site.spin_iterations.load(std::memory_order_relaxed)) * ticks_per_spin;
+            ranked.push_back({&site, wait,
+                              site.contended_acquisitions.load(std::memory_order_relaxed) + site.cas_failures.load(std::memory_order_relaxed)});
+        }
+        std::sort(ranked.begin(), ranked.end(), [](const ranked_site& lhs, const ranked_site& rhs) {
+            if (lhs.wait_ticks != rhs.wait_ticks) {
+                return lhs.wait_ticks > rhs.wait_ticks;
+            }
+            return lhs.conflicts > rhs.conflicts;
+        });
+        if (top != 0 && ranked.size() > top) {
+            ranked.resize(top);
+        }
+
+        std::ostringstream out;
+        out << "contention report (timings sampled 1/" << GP_CONTENTION_SAMPLE_RATE << ", ns)\n";
+        for (std::size_t rank = 0; rank < ranked.size(); ++rank) {
+            const contention_site& site = *ranked[rank].site;
+            const uint64_t acquisitions = site.acquisitions.load(std::memory_order_relaxed);
+            const uint64_t contended = site.contended_acquisitions.load(std::memory_order_relaxed);
+            const uint64_t cas_attempts = site.cas_attempts.load(std::memory_order_relaxed);
+            const uint64_t cas_failures = site.cas_failures.load(std::memory_order_relaxed);
+            out << '#' << rank + 1 << ' ' << site.name
+                << ": acquisitions=" << acquisitions
+                << " contended=" << percent(contended, acquisitions) << '%'
+                << " spins=" << site.spin_iterations.load(std::memory_order_relaxed)
+                << " failed_try_locks=" << site.failed_try_locks.load(std::memory_order_relaxed)
+                << " est_total_wait=" << static_cast<uint64_t>(ranked[rank].wait_ticks * ns_per_tick)
+                << " wait_samples=" << site.wait_ticks.total()
+                << " wait_p50=" << static_cast<uint64_t>(site.wait_ticks.quantile(0.5) * ns_per_tick)
+                << " wait_p99=" << static_cast<uint64_t>(site.wait_ticks.quantile(0.99) * ns_per_tick)
+                << " hold_p50=" << static_cast<uint64_t>(site.hold_ticks.quantile(0.5) * ns_per_tick)
+                << " hold_p99=" << static_cast<uint64_t>(site.hold_ticks.quantile(0.99) * ns_per_tick)
+                << " cas=" << cas_attempts
+                << " cas_failed=" << percent(cas_failures, cas_attempts) << "%\n";
+        }
+        return out.str();
+    }
+
+private:
+    contention_registry()
+        : m_start_ticks(contention_clock::now()), m_start_time(std::chrono::steady_clock::now()) {}
+
+    static double percent(uint64_t part, uint64_t total) {
+        return total == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(total);
+    }
+
+    double nanoseconds_per_tick() const {
+        const uint64_t ticks = contention_clock::now() - m_start_ticks;
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start_time).count();
+        return ticks == 0 ? 1.0 : static_cast<double>(elapsed) / static_cast<double>(ticks);
+    }
+
+    std::mutex m_lock;
+    std::deque<contention_site> m_sites;
+    std::unordered_map<std::string, contention_site*> m_index;
+    const uint64_t m_start_ticks;
+    const std::chrono::steady_clock::time_point m_start_time;
+};
+
+} // namespace gp
+
+#endif
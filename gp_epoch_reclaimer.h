@@ -0,0 +1,333 @@
+#ifndef _GP_EPOCH_RECLAIMER_H_
+#define _GP_EPOCH_RECLAIMER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "gp_atomic.h"
+
+namespace gp {
+
+   /// @brief Process wide epoch based reclamation domain
+   /// Readers bracket accesses to shared nodes with an epoch_guard, which publishes the global
+   /// epoch they observed. A writer unlinks a node and hands it to retire(), which only appends it
+   /// to one of three thread local buckets (one per epoch modulo 3), so retire is O(1) and writes
+   /// nothing shared. Every collect_interval retires the thread tries to advance the global epoch
+   /// (possible once every reader inside a critical section has observed the current one) and
+   /// frees its buckets that are at least two epochs old, no reader can still hold those nodes.
+   /// A thread that exits hands its pending buckets to a global orphan list, which the same
+   /// periodic collect frees once old enough (skipped while another thread holds the list).
+   /// start_background() runs a thread that keeps advancing the epoch and frees orphans, so idle
+   /// retirers still make progress on their next retire.
+   class epoch_domain
+   {
+      public:
+      static constexpr std::size_t collect_interval = 64;
+
+      using reclaim_function = void (*)(void* pointer, void* context);
+
+      static epoch_domain& instance()
+      {
+         static epoch_domain domain;
+         return domain;
+      }
+
+      /// @brief Enter a (possibly nested) read side critical section
+      void enter()
+      {
+         thread_state* state = local_state();
+         if(state == nullptr || state->nesting++ != 0)
+            return;
+         const uint64_t epoch = m_epoch.load(std::memory_order_relaxed);
+         state->record->state.store((epoch << 1) | 1, std::memory_order_relaxed);
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+      }
+
+      void leave()
+      {
+         thread_state* state = local_state();
+         if(state == nullptr || --state->nesting != 0)
+            return;
+         state->record->state.store(0, std::memory_order_release);
+      }
+
+      /// @brief Defer reclaim(pointer, context) until every reader that could see pointer left
+      void retire(void* pointer, reclaim_function reclaim, void* context = nullptr)
+      {
+         const uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+         thread_state* state = local_state();
+         if(state == nullptr)
+         {
+            // Thread teardown, its buckets are gone already
+            orphan(epoch, {{pointer, reclaim, context}});
+            return;
+         }
+         retire_bucket& bucket = state->buckets[epoch % bucket_count];
+         if(bucket.epoch != epoch)
+         {
+            // The slot last held epoch - 3 or older, long safe
+            free_nodes(bucket.nodes);
+            bucket.epoch = epoch;
+         }
+         bucket.nodes.push_back({pointer, reclaim, context});
+         if(++state->retired_since_collect >= collect_interval)
+         {
+            state->retired_since_collect = 0;
+            try_advance();
+            collect(*state);
+            collect_orphans();
+         }
+      }
+
+      /// @brief Defer delete pointer until every reader that could see it left
+      template <typename T>
+      void retire(T* pointer)
+      {
+         retire(pointer, [](void* p, void*) { delete static_cast<T*>(p); });
+      }
+
+      /// @brief Try to advance the epoch and free what the calling thread and exited threads retired
+      void reclaim()
+      {
+         try_advance();
+         thread_state* state = local_state();
+         if(state != nullptr)
+            collect(*state);
+         collect_orphans();
+      }
+
+      /// @brief Advance the global epoch if every active reader observed the current one
+      bool try_advance()
+      {
+         uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+         for(thread_record* record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->next)
+         {
+            const uint64_t state = record->state.load(std::memory_order_seq_cst);
+            if((state & 1) != 0 && (state >> 1) != epoch)
+               return false;
+         }
+         return m_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+      }
+
+      uint64_t epoch() const
+      {
+         return m_epoch.load(std::memory_order_acquire);
+      }
+
+      /// @brief Advance the epoch and free orphans every period on a helper thread
+      void start_background(std::chrono::milliseconds period = std::chrono::milliseconds(10))
+      {
+         m_background_lock.lock();
+         if(!m_background.joinable())
+         {
+            m_stop_background.store(false, std::memory_order_relaxed);
+            m_background = std::thread([this, period] {
+               while(!m_stop_background.load(std::memory_order_acquire))
+               {
+                  try_advance();
+                  collect_orphans();
+                  std::this_thread::sleep_for(period);
+               }
+            });
+         }
+         m_background_lock.unlock();
+      }
+
+      void stop_background()
+      {
+         m_background_lock.lock();
+         if(m_background.joinable())
+         {
+            m_stop_background.store(true, std::memory_order_release);
+            m_background.join();
+         }
+         m_background_lock.unlock();
+      }
+
+      private:
+      static constexpr std::size_t bucket_count = 3;
+
+      struct retired_node
+      {
+         void* pointer;
+         reclaim_function reclaim;
+         void* context;
+      };
+
+      /// state is (observed epoch << 1) | 1 inside a critical section, 0 outside
+      struct alignas(cache_line_size) thread_record
+      {
+         std::atomic<uint64_t> state{0};
+         std::atomic<bool> in_use{false};
+         thread_record* next = nullptr;
+      };
+
+      struct retire_bucket
+      {
+         uint64_t epoch = 0;
+         std::vector<retired_node> nodes;
+      };
+
+      struct orphan_batch
+      {
+         uint64_t epoch;
+         std::vector<retired_node> nodes;
+      };
+
+      struct thread_state
+      {
+         epoch_domain* domain;
+         thread_record* record;
+         unsigned nesting = 0;
+         std::size_t retired_since_collect = 0;
+         retire_bucket buckets[bucket_count];
+
+         explicit thread_state(epoch_domain* domain) : domain(domain), record(domain->acquire_record()) {}
+        ~thread_state()
+         {
+            domain->release_record(*this);
+            destroyed() = true;
+         }
+
+         static bool& destroyed()
+         {
+            static thread_local bool flag = false;
+            return flag;
+         }
+      };
+
+      epoch_domain() = default;
+      epoch_domain(const epoch_domain&) = delete;
+      epoch_domain& operator=(const epoch_domain&) = delete;
+
+     ~epoch_domain()
+      {
+         stop_background();
+         // Process teardown, no readers are left
+         for(auto& batch : m_orphans)
+            free_nodes(batch.nodes);
+         thread_record* record = m_records.load();
+         while(record != nullptr)
+         {
+            thread_record* next = record->next;
+            delete record;
+            record = next;
+         }
+      }
+
+      /// nullptr once the calling thread's state was destroyed (late retires at thread exit)
+      thread_state* local_state()
+      {
+         if(thread_state::destroyed())
+            return nullptr;
+         static thread_local thread_state state(this);
+         return &state;
+      }
+
+      /// Reclaim functions may retire again, so the nodes are detached before they run
+      static void free_nodes(std::vector<retired_node>& nodes)
+      {
+         if(nodes.empty())
+            return;
+         std::vector<retired_node> reclaimable;
+         reclaimable.swap(nodes);
+         for(auto& node : reclaimable)
+            node.reclaim(node.pointer, node.context);
+      }
+
+      void collect(thread_state& state)
+      {
+         const uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+         for(auto& bucket : state.buckets)
+         {
+            if(bucket.epoch + 2 <= epoch)
+               free_nodes(bucket.nodes);
+         }
+      }
+
+      void collect_orphans()
+      {
+         if(!m_orphan_lock.try_lock())
+            return;
+         const uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+         std::vector<retired_node> reclaimable;
+         for(std::size_t i = 0; i < m_orphans.size();)
+         {
+            if(m_orphans[i].epoch + 2 <= epoch)
+            {
+               reclaimable.insert(reclaimable.end(), m_orphans[i].nodes.begin(), m_orphans[i].nodes.end());
+               m_orphans[i] = std::move(m_orphans.back());
+               m_orphans.pop_back();
+            }
+            else
+            {
+               ++i;
+            }
+         }
+         m_orphan_lock.unlock();
+         free_nodes(reclaimable);
+      }
+
+      void orphan(uint64_t epoch, std::vector<retired_node> nodes)
+      {
+         m_orphan_lock.lock();
+         m_orphans.push_back({epoch, std::move(nodes)});
+         m_orphan_lock.unlock();
+      }
+
+      thread_record* acquire_record()
+      {
+         for(thread_record* record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->next)
+         {
+            bool expected = false;
+            if(!record->in_use.load(std::memory_order_relaxed) &&
+               record->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+               return record;
+            }
+         }
+         thread_record* record = new thread_record();
+         record->in_use.store(true, std::memory_order_relaxed);
+         record->next = m_records.load(std::memory_order_relaxed);
+         while(!m_records.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed)) { }
+         return record;
+      }
+
+      void release_record(thread_state& state)
+      {
+         state.record->state.store(0, std::memory_order_release);
+         collect(state);
+         for(auto& bucket : state.buckets)
+         {
+            if(!bucket.nodes.empty())
+               orphan(bucket.epoch, std::move(bucket.nodes));
+         }
+         state.record->in_use.store(false, std::memory_order_release);
+      }
+
+      alignas(cache_line_size) std::atomic<uint64_t> m_epoch{0};
+      std::atomic<thread_record*> m_records{nullptr};
+      spinlock m_orphan_lock;
+      std::vector<orphan_batch> m_orphans;
+      spinlock m_background_lock;
+      std::atomic<bool> m_stop_background{false};
+      std::thread m_background;
+   };
+
+   /// @brief RAII read side critical section of the epoch_domain
+   class epoch_guard
+   {
+      public:
+      epoch_guard() { epoch_domain::instance().enter(); }
+     ~epoch_guard() { epoch_domain::instance().leave(); }
+
+      epoch_guard(const epoch_guard&) = delete;
+      epoch_guard& operator=(const epoch_guard&) = delete;
+   };
+
+} // namespace gp
+
+#endif
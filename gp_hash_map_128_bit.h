@@ -3,6 +3,8 @@
 
 #include <deque>
 #include <memory>
+#include <memory_resource>
+#include <utility>
 #include <array>
 #include <stack>
 #include <stdexcept>
@@ -75,10 +77,8 @@ struct _128_BIT_HASH_
     }
 
 
-    _128_BIT_HASH_(const _128_BIT_HASH_& hash) {
-        _128_bit_id._64_bit_id[0] = hash._128_bit_id._64_bit_id[0];
-        _128_bit_id._64_bit_id[1] = hash._128_bit_id._64_bit_id[1];
-    }
+    /// Defaulted copies keep the hash trivially copyable (usable with gp::atomic)
+    _128_BIT_HASH_(const _128_BIT_HASH_& hash) = default;
     
     _128_BIT_HASH_(const uint64_t& id_1, const uint64_t& id_2) {
         if(id_1 < id_2)
@@ -93,11 +93,7 @@ struct _128_BIT_HASH_
         }
     }
 
-    _128_BIT_HASH_& operator=(const _128_BIT_HASH_& hash) {
-        _128_bit_id._64_bit_id[0] = hash._128_bit_id._64_bit_id[0];
-        _128_bit_id._64_bit_id[1] = hash._128_bit_id._64_bit_id[1];
-        return *this;
-    }
+    _128_BIT_HASH_& operator=(const _128_BIT_HASH_& hash) = default;
 
     bool operator==(const _128_BIT_HASH_& hash) const {
         return _128_bit_id._64_bit_id[0] == hash._128_bit_id._64_bit_id[0] && _128_bit_id._64_bit_id[1] == hash._128_bit_id._64_bit_id[1];
@@ -187,7 +183,9 @@ class HashMap {
     }; // struct HashMap::pair
 
 private:
-    std::deque<pair<Key, Value>> hash_table[max_domains];
+    using domain_type = std::pmr::deque<pair<Key, Value>>;
+    std::array<domain_type, max_domains> hash_table;
+    std::pmr::memory_resource* m_resource;
     Hash hash_fun;
     struct free_index 
     {
@@ -201,7 +199,12 @@ private:
 
 public:
     // Constructor
-    HashMap() {}
+    HashMap() : HashMap(std::pmr::get_default_resource()) {}
+
+    /// @brief Draw the domains, keys and values from resource (e.g. a gp::pool_resource)
+    /// Keys and values are co-allocated with their shared_ptr control blocks.
+    explicit HashMap(std::pmr::memory_resource* resource)
+        : hash_table(make_domains(resource, std::make_index_sequence<max_domains>())), m_resource(resource) {}
 
     // Destructor
     ~HashMap() {}
@@ -218,7 +221,7 @@ public:
             }
         }
         /// else create a new pair in the domain
-        hash_table[domain_index].push_back(pair<Key, Value>(std::make_shared<Key>(key), std::make_shared<Value>(value), hash_val));
+        hash_table[domain_index].push_back(make_node(key, value, hash_val));
     }
 
     /// @brief Retrieve value associated with key
@@ -243,7 +246,7 @@ public:
             }
         }
         Value value;  
-        hash_table[domain_index].push_back(pair<Key, Value>(std::make_shared<Key>(key), std::make_shared<Value>(value), hash_val));
+        hash_table[domain_index].push_back(make_node(key, value, hash_val));
         return *(hash_table[domain_index].back().value);
      }
     
@@ -256,7 +259,7 @@ public:
             }
         }
         Value value;  
-        hash_table[domain_index].push_back(pair<Key, Value>(std::make_shared<Key>(key), std::make_shared<Value>(value), hash_val));
+        hash_table[domain_index].push_back(make_node(key, value, hash_val));
         return *(hash_table[domain_index].back().value);
     }
 
@@ -404,8 +407,24 @@ public:
         return end();
     }
 
+    ///@brief Memory resource backing the domains, keys and values
+    std::pmr::memory_resource* get_resource() const {
+        return m_resource;
+    }
+
     private :
 
+    template <size_t... domain>
+    static std::array<domain_type, max_domains> make_domains(std::pmr::memory_resource* resource, std::index_sequence<domain...>) {
+        return {{ ((void)domain, domain_type(resource))... }};
+    }
+
+    pair<Key, Value> make_node(const Key& key, const Value& value, const _128_BIT_HASH_& hash_val) {
+        return pair<Key, Value>(std::allocate_shared<Key>(std::pmr::polymorphic_allocator<Key>(m_resource), key),
+                                std::allocate_shared<Value>(std::pmr::polymorphic_allocator<Value>(m_resource), value),
+                                hash_val);
+    }
+
     size_t eval_domain_index(const _128_BIT_HASH_& hash_val) {
         size_t sub_domain[4];
         size_t domain_index = ((hash_val._128_bit_id._64_bit_id[0] % max_domains) + (hash_val._128_bit_id._64_bit_id[1] % max_domains)) % max_domains;
@@ -1,9 +1,23 @@
 #ifndef _HAZARD_MEM_ALLOCATOR_H_
 #define _HAZARD_MEM_ALLOCATOR_H_
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
 #include <stdexcept>
 #include <memory>
-#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define GP_POOL_HAS_MMAP 1
+#else
+#include <new>
+#endif
+
+#include "gp_atomic.h"
 
 
 class memory_allocator_details {
@@ -17,60 +31,1506 @@ class memory_allocator_details {
 
 };
 
+/// @brief Process wide hazard pointer domain
+/// Every thread owns a record of slots_per_thread hazard slots. A reader publishes the pointer
+/// it is about to dereference in one of its slots (HazardPointer::protect), a writer hands
+/// unlinked nodes to retire(). Retired nodes are kept in a thread local list and only reclaimed
+/// by a scan once no hazard slot holds them. Scans run when the list outgrows twice the number
+/// of hazard slots, so reclamation costs amortized O(1) per retire.
+class HazardPointerDomain
+{
+    public:
+    static constexpr std::size_t slots_per_thread = 4;
+    static constexpr std::size_t min_scan_threshold = 64;
+
+    using reclaim_function = void (*)(void* pointer, void* context);
+
+    struct alignas(gp::cache_line_size) thread_record
+    {
+        std::atomic<const void*> hazards[slots_per_thread] = {};
+        std::atomic<bool> active{false};
+        thread_record* next = nullptr;
+    };
+
+    struct retired_node
+    {
+        void* pointer;
+        reclaim_function reclaim;
+        void* context;
+    };
+
+    static HazardPointerDomain& instance()
+    {
+        static HazardPointerDomain domain;
+        return domain;
+    }
+
+    /// @brief Defer reclaim(pointer, context) until no thread protects pointer
+    void retire(void* pointer, reclaim_function reclaim, void* context = nullptr)
+    {
+        thread_state& state = local_state();
+        state.retired.push_back({pointer, reclaim, context});
+        if (state.retired.size() >= scan_threshold())
+        {
+            scan(state.retired);
+        }
+    }
+
+    /// @brief Defer delete pointer until no thread protects it
+    template <class T>
+    void retire(T* pointer)
+    {
+        retire(pointer, [](void* p, void*) { delete static_cast<T*>(p); });
+    }
+
+    /// @brief Reclaim whatever the calling thread retired that is no longer protected
+    void scan()
+    {
+        scan(local_state().retired);
+    }
+
+    /// @brief Claim a free hazard slot of the calling thread (used by HazardPointer)
+    std::atomic<const void*>& acquire_slot()
+    {
+        thread_state& state = local_state();
+        for (std::size_t i = 0; i < slots_per_thread; ++i)
+        {
+            if ((state.used_slots & (1u << i)) == 0)
+            {
+                state.used_slots |= (1u << i);
+                return state.record->hazards[i];
+            }
+        }
+        throw std::runtime_error("Out of hazard pointer slots!");
+    }
+
+    void release_slot(std::atomic<const void*>& slot)
+    {
+        thread_state& state = local_state();
+        slot.store(nullptr, std::memory_order_release);
+        state.used_slots &= ~(1u << static_cast<unsigned>(&slot - state.record->hazards));
+    }
+
+    private:
+    struct thread_state
+    {
+        HazardPointerDomain* domain;
+        thread_record* record;
+        unsigned used_slots = 0;
+        std::vector<retired_node> retired;
+
+        explicit thread_state(HazardPointerDomain* domain) : domain(domain), record(domain->acquire_record()) {}
+       ~thread_state()
+        {
+            domain->scan(retired);
+            domain->release_record(record, retired);
+        }
+    };
+
+    HazardPointerDomain() = default;
+    HazardPointerDomain(const HazardPointerDomain&) = delete;
+    HazardPointerDomain& operator=(const HazardPointerDomain&) = delete;
+
+   ~HazardPointerDomain()
+    {
+        // Process teardown, no readers are left
+        for (auto& node : m_orphans)
+        {
+            node.reclaim(node.pointer, node.context);
+        }
+        thread_record* record = m_records.load();
+        while (record != nullptr)
+        {
+            thread_record* next = record->next;
+            delete record;
+            record = next;
+        }
+    }
+
+    thread_state& local_state()
+    {
+        static thread_local thread_state state(this);
+        return state;
+    }
+
+    std::size_t scan_threshold() const
+    {
+        return std::max(min_scan_threshold, 2 * slots_per_thread * m_record_count.load(std::memory_order_relaxed));
+    }
+
+    thread_record* acquire_record()
+    {
+        for (thread_record* record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->next)
+        {
+            bool expected = false;
+            if (!record->active.load(std::memory_order_relaxed) &&
+                record->active.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                return record;
+            }
+        }
+        thread_record* record = new thread_record();
+        record->active.store(true, std::memory_order_relaxed);
+        record->next = m_records.load(std::memory_order_relaxed);
+        while (!m_records.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed)) { }
+        m_record_count.fetch_add(1, std::memory_order_relaxed);
+        return record;
+    }
+
+    void release_record(thread_record* record, std::vector<retired_node>& retired)
+    {
+        for (auto& hazard : record->hazards)
+        {
+            hazard.store(nullptr, std::memory_order_release);
+        }
+        if (!retired.empty())
+        {
+            // Still protected by other threads, let the next scan anywhere pick them up
+            m_orphan_lock.lock();
+            m_orphans.insert(m_orphans.end(), retired.begin(), retired.end());
+            m_orphan_lock.unlock();
+            retired.clear();
+        }
+        record->active.store(false, std::memory_order_release);
+    }
+
+    void scan(std::vector<retired_node>& retired)
+    {
+        if (m_orphan_lock.try_lock())
+        {
+            retired.insert(retired.end(), m_orphans.begin(), m_orphans.end());
+            m_orphans.clear();
+            m_orphan_lock.unlock();
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::vector<const void*> hazards;
+        for (thread_record* record = m_records.load(std::memory_order_acquire); record != nullptr; record = record->next)
+        {
+            for (auto& hazard : record->hazards)
+            {
+                const void* pointer = hazard.load(std::memory_order_acquire);
+                if (pointer != nullptr)
+                {
+                    hazards.push_back(pointer);
+                }
+            }
+        }
+        std::sort(hazards.begin(), hazards.end());
+
+        auto still_protected = std::partition(retired.begin(), retired.end(), [&hazards](const retired_node& node) {
+            return std::binary_search(hazards.begin(), hazards.end(), static_cast<const void*>(node.pointer));
+        });
+        std::vector<retired_node> reclaimable(still_protected, retired.end());
+        retired.erase(still_protected, retired.end());
+        for (auto& node : reclaimable)
+        {
+            node.reclaim(node.pointer, node.context);
+        }
+    }
+
+    std::atomic<thread_record*> m_records{nullptr};
+    std::atomic<std::size_t> m_record_count{0};
+    gp::spinlock m_orphan_lock;
+    std::vector<retired_node> m_orphans;
+};
+
+
+/// @brief RAII owner of one hazard slot of the calling thread
+/// Must be used (and destroyed) on the thread that created it.
+class HazardPointer
+{
+    public:
+    HazardPointer() : m_slot(HazardPointerDomain::instance().acquire_slot()) {}
+   ~HazardPointer() { HazardPointerDomain::instance().release_slot(m_slot); }
+
+    HazardPointer(const HazardPointer&) = delete;
+    HazardPointer& operator=(const HazardPointer&) = delete;
+
+    /// @brief Load src and publish it until the published value is confirmed current
+    /// The returned pointer stays valid until reset() or destruction, even if it gets retired.
+    template <class T>
+    T* protect(const std::atomic<T*>& src)
+    {
+        T* pointer = src.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            m_slot.store(pointer, std::memory_order_seq_cst);
+            T* current = src.load(std::memory_order_acquire);
+            if (current == pointer)
+            {
+                return pointer;
+            }
+            pointer = current;
+        }
+    }
+
+    /// @brief Publish pointer as is, the caller must validate it is still reachable afterwards
+    void protect(const void* pointer)
+    {
+        m_slot.store(pointer, std::memory_order_seq_cst);
+    }
+
+    void reset()
+    {
+        m_slot.store(nullptr, std::memory_order_release);
+    }
+
+    private:
+    std::atomic<const void*>& m_slot;
+};
+
+
+/// @brief Dense index of the calling thread, recycled when the thread exits
+/// Lets per-thread state live in plain arrays owned by each pool instead of in thread_local maps.
+/// Owners of per-index state register an exit hook, which runs on the exiting thread before its
+/// index can be handed to a new thread. Once the index is released get() returns no_index, so
+/// later thread exit destructors (hazard scans, ...) take the owners' shared locked paths.
+class HazardThreadIndex
+{
+    public:
+    static constexpr std::size_t no_index = static_cast<std::size_t>(-1);
+
+    using exit_hook = void (*)(void* owner, std::size_t index);
+
+    static std::size_t get()
+    {
+        if (destroyed())
+        {
+            return no_index;
+        }
+        static thread_local holder current;
+        return current.index;
+    }
+
+    /// @brief Run hook(owner, index) when the calling thread exits, before its index is recycled
+    static void on_thread_exit(exit_hook hook, void* owner)
+    {
+        const std::size_t index = get();
+        if (index == no_index)
+        {
+            return;
+        }
+        registry& reg = get_registry();
+        reg.lock.lock();
+        reg.hooks[index].push_back({hook, owner});
+        reg.lock.unlock();
+    }
+
+    /// @brief Drop every hook registered for owner (call from the owner's destructor)
+    static void forget(void* owner)
+    {
+        registry& reg = get_registry();
+        reg.lock.lock();
+        for (auto& hooks : reg.hooks)
+        {
+            hooks.erase(std::remove_if(hooks.begin(), hooks.end(), [owner](const hook_entry& entry) { return entry.owner == owner; }),
+                        hooks.end());
+        }
+        reg.lock.unlock();
+    }
+
+    private:
+    struct hook_entry
+    {
+        exit_hook hook;
+        void* owner;
+    };
+
+    struct registry
+    {
+        gp::spinlock lock;
+        std::vector<std::size_t> free_indices;
+        std::size_t next_index = 0;
+        std::vector<std::vector<hook_entry>> hooks;
+    };
+
+    static registry& get_registry()
+    {
+        static registry instance;
+        return instance;
+    }
+
+    /// Trivially destructible, stays readable after the holder is gone
+    static bool& destroyed()
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+
+    struct holder
+    {
+        std::size_t index;
+        holder()
+        {
+            registry& reg = get_registry();
+            reg.lock.lock();
+            if (reg.free_indices.empty())
+            {
+                index = reg.next_index++;
+                reg.hooks.emplace_back();
+            }
+            else
+            {
+                // Lowest recycled index keeps the per-pool caches dense
+                auto lowest = std::min_element(reg.free_indices.begin(), reg.free_indices.end());
+                index = *lowest;
+                reg.free_indices.erase(lowest);
+            }
+            reg.lock.unlock();
+        }
+       ~holder()
+        {
+            destroyed() = true;
+            registry& reg = get_registry();
+            // Hooks run under the registry lock so their owners cannot be destroyed meanwhile
+            reg.lock.lock();
+            for (const hook_entry& entry : reg.hooks[index])
+            {
+                entry.hook(entry.owner, index);
+            }
+            reg.hooks[index].clear();
+            reg.free_indices.push_back(index);
+            reg.lock.unlock();
+        }
+    };
+};
+
+
+#ifdef GP_POOL_CALLSITE_SAMPLING
+#ifndef GP_POOL_CALLSITE_SAMPLE_RATE
+#define GP_POOL_CALLSITE_SAMPLE_RATE 64
+#endif
+/// Trailing allocate() parameters capturing the caller's location
+/// This is the immediate caller only: allocations made through std containers land in
+/// <bits/alloc_traits.h>, through gp::pool_resource in gp_memory_resource.h. Wrap such code in a
+/// HazardPoolCallsiteScope to attribute it.
+#define GP_POOL_CALLSITE_PARAMS , const char* callsite_file = __builtin_FILE(), int callsite_line = __builtin_LINE()
+#define GP_POOL_CALLSITE_ARGS , callsite_file, callsite_line
+#else
+#define GP_POOL_CALLSITE_PARAMS
+#define GP_POOL_CALLSITE_ARGS
+#endif
+
+
+/// @brief Attributes every pool allocation the calling thread makes while it is alive
+/// Records the scope's own location (and optional label) instead of the immediate caller of
+/// allocate(), which is library code for containers and memory resources. Scopes nest, the
+/// innermost wins. Without GP_POOL_CALLSITE_SAMPLING the scope is empty and costs nothing.
+///     HazardPoolCallsiteScope scope("routing table rebuild");
+///     table.insert(...);
+class HazardPoolCallsiteScope
+{
+    public:
+#ifdef GP_POOL_CALLSITE_SAMPLING
+    explicit HazardPoolCallsiteScope(const char* label = nullptr, const char* file = __builtin_FILE(), int line = __builtin_LINE())
+        : label(label), file(file), line(line), m_outer(innermost())
+    {
+        innermost() = this;
+    }
+
+   ~HazardPoolCallsiteScope() { innermost() = m_outer; }
+
+    /// Innermost scope of the calling thread, nullptr outside of any
+    static const HazardPoolCallsiteScope* current() { return innermost(); }
+
+    const char* const label;
+    const char* const file;
+    const int line;
+
+    private:
+    static const HazardPoolCallsiteScope*& innermost()
+    {
+        static thread_local const HazardPoolCallsiteScope* scope = nullptr;
+        return scope;
+    }
+
+    const HazardPoolCallsiteScope* m_outer;
+#else
+    explicit HazardPoolCallsiteScope(const char* = nullptr) {}
+#endif
+
+    HazardPoolCallsiteScope(const HazardPoolCallsiteScope&) = delete;
+    HazardPoolCallsiteScope& operator=(const HazardPoolCallsiteScope&) = delete;
+};
+
+
+/// @brief Point in time view of a HazardMemoryPool
+/// Counters are gathered from every thread cache without stopping them, so a snapshot taken
+/// under load may be off by the operations in flight.
+struct HazardPoolStats
+{
+    struct callsite
+    {
+        const char* file;
+        int line;
+        /// Label of the HazardPoolCallsiteScope that was active, nullptr for direct callers
+        const char* label;
+        uint64_t samples;
+        uint64_t bytes;
+    };
+
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    uint64_t out_of_memory_events = 0;
+    /// Objects and bytes requested by callers and not yet returned
+    uint64_t live_objects = 0;
+    uint64_t live_bytes = 0;
+    /// Bytes of the blocks backing live objects
+    uint64_t live_block_bytes = 0;
+    /// Internal fragmentation: live_block_bytes - live_bytes (size class and granule rounding)
+    uint64_t rounding_waste_bytes = 0;
+    /// Carved blocks sitting on the slab free lists
+    uint64_t free_list_bytes = 0;
+    /// Carved blocks sitting in thread magazines and the depot
+    uint64_t cached_bytes = 0;
+    /// Bytes carved out of chunks now and at the peak
+    uint64_t carved_bytes = 0;
+    uint64_t high_water_bytes = 0;
+    uint64_t chunks = 0;
+    uint64_t purged_chunks = 0;
+    uint64_t mapped_bytes = 0;
+    /// Seconds since the pool was created, the timestamp of the snapshot
+    double uptime_seconds = 0;
+    /// Averages over the whole uptime, see rates_since() for current rates
+    double lifetime_allocations_per_second = 0;
+    double lifetime_deallocations_per_second = 0;
+    /// Sampled allocation sites, only filled with GP_POOL_CALLSITE_SAMPLING
+    std::vector<callsite> callsites;
+
+    struct rates
+    {
+        double seconds;
+        double allocations_per_second;
+        double deallocations_per_second;
+    };
+
+    /// @brief Rates between an earlier snapshot of the same pool and this one
+    /// Snapshots are plain values, so every consumer keeps its own previous one.
+    rates rates_since(const HazardPoolStats& earlier) const
+    {
+        const double seconds = uptime_seconds - earlier.uptime_seconds;
+        if (seconds <= 0)
+        {
+            return {0, 0, 0};
+        }
+        return {seconds, (allocations - earlier.allocations) / seconds, (deallocations - earlier.deallocations) / seconds};
+    }
+
+    std::string to_json() const
+    {
+        std::ostringstream out;
+        out << "{\"allocations\":" << allocations
+            << ",\"deallocations\":" << deallocations
+            << ",\"out_of_memory_events\":" << out_of_memory_events
+            << ",\"live_objects\":" << live_objects
+            << ",\"live_bytes\":" << live_bytes
+            << ",\"live_block_bytes\":" << live_block_bytes
+            << ",\"rounding_waste_bytes\":" << rounding_waste_bytes
+            << ",\"free_list_bytes\":" << free_list_bytes
+            << ",\"cached_bytes\":" << cached_bytes
+            << ",\"carved_bytes\":" << carved_bytes
+            << ",\"high_water_bytes\":" << high_water_bytes
+            << ",\"chunks\":" << chunks
+            << ",\"purged_chunks\":" << purged_chunks
+            << ",\"mapped_bytes\":" << mapped_bytes
+            << ",\"uptime_seconds\":" << uptime_seconds
+            << ",\"lifetime_allocations_per_second\":" << lifetime_allocations_per_second
+            << ",\"lifetime_deallocations_per_second\":" << lifetime_deallocations_per_second
+            << ",\"callsites\":[";
+        auto quoted = [&out](const char* text) {
+            out << '"';
+            for (const char* c = text; *c != '\0'; ++c)
+            {
+                if (*c == '"' || *c == '\\')
+                {
+                    out << '\\';
+                }
+                out << *c;
+            }
+            out << '"';
+        };
+        for (std::size_t i = 0; i < callsites.size(); ++i)
+        {
+            out << (i == 0 ? "" : ",") << "{\"file\":";
+            quoted(callsites[i].file);
+            if (callsites[i].label != nullptr)
+            {
+                out << ",\"label\":";
+                quoted(callsites[i].label);
+            }
+            out << ",\"line\":" << callsites[i].line
+                << ",\"samples\":" << callsites[i].samples
+                << ",\"bytes\":" << callsites[i].bytes << "}";
+        }
+        out << "]}";
+        return out.str();
+    }
+};
+
+
+/// @brief Growth and retention knobs of HazardMemoryPool
+struct HazardPoolConfig
+{
+    /// Fully free chunks kept resident, further ones are handed back to the OS (MADV_DONTNEED)
+    std::size_t retained_chunks = 1;
+    /// Back chunks with huge pages: MAP_HUGETLB when the chunk is a multiple of 2MB and
+    /// hugetlbfs pages are reserved, MADV_HUGEPAGE (transparent huge pages) otherwise
+    bool huge_pages = false;
+};
+
+
+/// @brief Thread-safe growable pool with O(1) allocate / deallocate in any order
+/// Memory comes in chunks of `elements` granules (one granule holds one T and a free list link),
+/// mapped with mmap and aligned to their power of two size so a block finds its chunk by masking.
+/// Chunks are carved into blocks of 2^k granules. Freed blocks go onto an intrusive free list per
+/// size class, so nothing but the block itself is touched on the hot path. When the current chunk
+/// is exhausted a larger free block is split, and only then a new chunk is mapped.
+/// Blocks are not coalesced, but once every block of a chunk is free the whole chunk is reset and
+/// parked; past HazardPoolConfig::retained_chunks parked chunks its pages go back to the OS.
+///
+/// Single object blocks are served from per-thread magazines (loaded + previous, Bonwick style):
+/// allocate / deallocate only touch the calling thread's cache, with no atomics. Full and empty
+/// magazines are exchanged with a spinlock protected depot in batches of magazine_size.
+/// Multi object blocks and threads beyond cached_threads go to the slab under the lock.
+/// Debug builds track live blocks in an atomic bitmap and reject foreign pointers and double frees.
+/// get_stats() reports usage, fragmentation and rates (see HazardPoolStats).
 template <class T, std::size_t elements = 4096>
 class HazardMemoryPool :  public memory_allocator_details
 {
+    struct free_block
+    {
+        free_block* next;
+        free_block* prev;
+    };
+
+    static constexpr std::size_t ceil_log2(std::size_t value)
+    {
+        std::size_t result = 0;
+        while ((std::size_t(1) << result) < value)
+        {
+            ++result;
+        }
+        return result;
+    }
+
+    static constexpr std::size_t granule_alignment = alignof(T) > alignof(free_block) ? alignof(T) : alignof(free_block);
+
     public:
-    alignas(T) uint8_t buffer[elements*sizeof(T)];
+    static constexpr std::size_t granule_size =
+        ((sizeof(T) > sizeof(free_block) ? sizeof(T) : sizeof(free_block)) + granule_alignment - 1) / granule_alignment * granule_alignment;
+    static constexpr std::size_t size_classes = ceil_log2(elements) + 1;
+    /// Largest block (in granules) a chunk can hold
+    static constexpr std::size_t max_block_granules =
+        (std::size_t(1) << (size_classes - 1)) <= elements ? (std::size_t(1) << (size_classes - 1)) : (std::size_t(1) << (size_classes - 2));
+    static constexpr std::size_t magazine_size = 32;
+    static constexpr std::size_t cached_threads = 64;
+    /// Full magazines kept in the depot before their blocks go back to the free lists
+    static constexpr std::size_t depot_capacity = 8;
+
+    /// Bytes currently carved out of chunks (blocks handed out, cached or on free lists)
     std::atomic<std::size_t> nextIndex{0};
 
-    struct object_memory_info
+    HazardMemoryPool(const HazardPoolConfig& config = HazardPoolConfig())
+        : m_config(config), m_created(std::chrono::steady_clock::now()) {}
+   ~HazardMemoryPool()
     {
-        object_memory_info()  :  is_deallocated(false) {}
-       ~object_memory_info() {}
-        bool is_deallocated = false; 
-        size_t start_idx , end_idx;
-    };
+        HazardThreadIndex::forget(this);
+        for (auto& cache : m_thread_caches)
+        {
+            delete cache.loaded;
+            delete cache.previous;
+        }
+        delete_magazines(m_full_magazines);
+        delete_magazines(m_empty_magazines);
+        for (chunk_header* chunk : m_chunks)
+        {
+            unmap_chunk(chunk);
+        }
+    }
+
+    T* allocate(const size_t& obj_count = 1 GP_POOL_CALLSITE_PARAMS)
+    {
+        const std::size_t size_class = size_class_of(obj_count);
+        if (size_class >= size_classes || (std::size_t(1) << size_class) > max_block_granules)
+        {
+            m_out_of_memory_events.fetch_add(1, std::memory_order_relaxed);
+            throw std::runtime_error("Out of memory!");
+        }
+
+        uint8_t* block = nullptr;
+        bool sampled = false;
+        const std::size_t thread_index = HazardThreadIndex::get();
+        if (size_class == 0 && thread_index < cached_threads)
+        {
+            thread_cache& cache = m_thread_caches[thread_index];
+            register_thread_cache(cache);
+            block = allocate_cached(cache);
+            if (block != nullptr)
+            {
+                sampled = cache.counters.on_allocate(obj_count * sizeof(T), granule_size);
+            }
+        }
+        else
+        {
+            m_lock.lock();
+            block = allocate_block(size_class);
+            if (block != nullptr)
+            {
+                sampled = m_uncached_counters.on_allocate(obj_count * sizeof(T), granule_size << size_class);
+            }
+            m_lock.unlock();
+        }
+        if (block == nullptr)
+        {
+            m_out_of_memory_events.fetch_add(1, std::memory_order_relaxed);
+            throw std::runtime_error("Out of memory!");
+        }
+#ifdef GP_POOL_CALLSITE_SAMPLING
+        if (sampled)
+        {
+            if (const HazardPoolCallsiteScope* scope = HazardPoolCallsiteScope::current())
+            {
+                record_callsite(scope->file, scope->line, scope->label, obj_count * sizeof(T));
+            }
+            else
+            {
+                record_callsite(callsite_file, callsite_line, nullptr, obj_count * sizeof(T));
+            }
+        }
+#else
+        (void)sampled;
+#endif
+#ifndef NDEBUG
+        mark_allocated(block, true);
+#endif
+        return reinterpret_cast<T*>(block);
+    }
+
+    /// @param obj_count The count passed to allocate(), only used for the statistics
+    void deallocate(T*  pointer, const size_t& obj_count = 1)
+    {
+        uint8_t* block = reinterpret_cast<uint8_t*>(pointer);
+        chunk_header* chunk = chunk_of(block);
+#ifndef NDEBUG
+        if (chunk->owner != this || block < chunk->payload() ||
+            block >= chunk->payload() + chunk->bump.load(std::memory_order_relaxed) ||
+            (block - chunk->payload()) % granule_size != 0 || !mark_allocated(block, false))
+        {
+            throw std::runtime_error("Invalid deallocation!");
+        }
+#endif
+        const std::size_t thread_index = HazardThreadIndex::get();
+        const std::size_t size_class = chunk->block_class[granule_of(chunk, block)];
+        if (size_class == 0 && thread_index < cached_threads)
+        {
+            thread_cache& cache = m_thread_caches[thread_index];
+            register_thread_cache(cache);
+            deallocate_cached(cache, block);
+            cache.counters.on_deallocate(obj_count * sizeof(T), granule_size);
+        }
+        else
+        {
+            m_lock.lock();
+            release_block(block);
+            m_uncached_counters.on_deallocate(obj_count * sizeof(T), granule_size << size_class);
+            m_lock.unlock();
+        }
+    }
 
-    std::unordered_map<T*, object_memory_info> memory_block_map;
-    
-    HazardMemoryPool()  {}
-   ~HazardMemoryPool()  {}
+    /// @brief Slab allocation without the lock or the thread caches
+    /// For pools owned by one thread (gp::unsynchronized_pool_resource); must not be mixed with
+    /// allocate() / deallocate() on the same pool.
+    T* allocate_unsynchronized(const size_t& obj_count = 1)
+    {
+        const std::size_t size_class = size_class_of(obj_count);
+        uint8_t* block = nullptr;
+        if (size_class < size_classes && (std::size_t(1) << size_class) <= max_block_granules)
+        {
+            block = allocate_block(size_class);
+        }
+        if (block == nullptr)
+        {
+            m_out_of_memory_events.fetch_add(1, std::memory_order_relaxed);
+            throw std::runtime_error("Out of memory!");
+        }
+        m_uncached_counters.on_allocate(obj_count * sizeof(T), granule_size << size_class);
+#ifndef NDEBUG
+        mark_allocated(block, true);
+#endif
+        return reinterpret_cast<T*>(block);
+    }
 
-    T* allocate(const size_t& obj_count = 1)
+    void deallocate_unsynchronized(T* pointer, const size_t& obj_count = 1)
     {
-        if (nextIndex.load() + sizeof(T) >= sizeof(buffer))
+        uint8_t* block = reinterpret_cast<uint8_t*>(pointer);
+        chunk_header* chunk = chunk_of(block);
+#ifndef NDEBUG
+        if (chunk->owner != this || !mark_allocated(block, false))
         {
+            throw std::runtime_error("Invalid deallocation!");
+        }
+#endif
+        const std::size_t size_class = chunk->block_class[granule_of(chunk, block)];
+        release_block(block);
+        m_uncached_counters.on_deallocate(obj_count * sizeof(T), granule_size << size_class);
+    }
+
+    /// @brief Bump allocation of exactly the granules needed, never freed individually
+    /// For pools owned by one thread that only ever bump (gp::monotonic_resource); memory comes
+    /// back when the pool is destroyed. Must not be mixed with the other allocation paths.
+    T* allocate_bump(const size_t& obj_count = 1)
+    {
+        const std::size_t bytes = (obj_count == 0 ? 1 : obj_count) * sizeof(T);
+        const std::size_t block_bytes = (bytes + granule_size - 1) / granule_size * granule_size;
+        if (block_bytes > elements * granule_size)
+        {
+            m_out_of_memory_events.fetch_add(1, std::memory_order_relaxed);
             throw std::runtime_error("Out of memory!");
         }
-         
-        T* ptr = reinterpret_cast<T* >(&buffer[nextIndex]);
-        memory_block_map[ptr].start_idx = nextIndex.load();
-        nextIndex.fetch_add(obj_count*sizeof(T));
-        memory_block_map[ptr].end_idx = memory_block_map[ptr].start_idx + obj_count*sizeof(T); 
-        return ptr;
-    }
-
-    void deallocate(T*  pointer)
-    {
-          memory_block_map[pointer].is_deallocated = true;
-       // Deallocation is a no-op in this allocator
-       // Deferred Reclaimation 
-       // or Stack like reclaimation
-       if(memory_block_map[pointer].end_idx == nextIndex.load())
-       {
-           nextIndex.store(memory_block_map[pointer].start_idx);
-       } 
-          
-    }  
+        if (m_current == nullptr || m_current->bump.load(std::memory_order_relaxed) + block_bytes > elements * granule_size)
+        {
+            chunk_header* chunk = acquire_chunk();
+            if (chunk == nullptr)
+            {
+                m_out_of_memory_events.fetch_add(1, std::memory_order_relaxed);
+                throw std::runtime_error("Out of memory!");
+            }
+            m_current = chunk;
+        }
+        const std::size_t offset = m_current->bump.load(std::memory_order_relaxed);
+        m_current->bump.store(offset + block_bytes, std::memory_order_relaxed);
+        const std::size_t carved = nextIndex.fetch_add(block_bytes, std::memory_order_relaxed) + block_bytes;
+        m_high_water_bytes = std::max(m_high_water_bytes, carved);
+        m_uncached_counters.on_allocate(bytes, block_bytes);
+        return reinterpret_cast<T*>(m_current->payload() + offset);
+    }
+
+    HazardPoolStats get_stats()
+    {
+        HazardPoolStats stats;
+        int64_t live_objects = 0;
+        int64_t live_bytes = 0;
+        int64_t live_block_bytes = 0;
+        auto accumulate = [&](const usage_counters& counters) {
+            const uint64_t allocations = counters.allocations.load(std::memory_order_relaxed);
+            const uint64_t deallocations = counters.deallocations.load(std::memory_order_relaxed);
+            stats.allocations += allocations;
+            stats.deallocations += deallocations;
+            live_objects += static_cast<int64_t>(counters.allocated_objects.load(std::memory_order_relaxed)) -
+                            static_cast<int64_t>(counters.deallocated_objects.load(std::memory_order_relaxed));
+            live_bytes += static_cast<int64_t>(counters.allocated_bytes.load(std::memory_order_relaxed)) -
+                          static_cast<int64_t>(counters.deallocated_bytes.load(std::memory_order_relaxed));
+            live_block_bytes += static_cast<int64_t>(counters.allocated_block_bytes.load(std::memory_order_relaxed)) -
+                                static_cast<int64_t>(counters.deallocated_block_bytes.load(std::memory_order_relaxed));
+        };
+        for (const auto& cache : m_thread_caches)
+        {
+            accumulate(cache.counters);
+        }
+
+        m_lock.lock();
+        accumulate(m_uncached_counters);
+        stats.free_list_bytes = m_free_list_bytes;
+        stats.high_water_bytes = m_high_water_bytes;
+        stats.chunks = m_chunks.size();
+        stats.purged_chunks = m_purged_count;
+        m_lock.unlock();
+
+        stats.live_objects = static_cast<uint64_t>(std::max<int64_t>(live_objects, 0));
+        stats.live_bytes = static_cast<uint64_t>(std::max<int64_t>(live_bytes, 0));
+        stats.live_block_bytes = static_cast<uint64_t>(std::max<int64_t>(live_block_bytes, 0));
+        stats.rounding_waste_bytes = stats.live_block_bytes > stats.live_bytes ? stats.live_block_bytes - stats.live_bytes : 0;
+        stats.carved_bytes = nextIndex.load(std::memory_order_relaxed);
+        const uint64_t accounted = stats.live_block_bytes + stats.free_list_bytes;
+        stats.cached_bytes = stats.carved_bytes > accounted ? stats.carved_bytes - accounted : 0;
+        stats.mapped_bytes = stats.chunks * chunk_bytes;
+        stats.out_of_memory_events = m_out_of_memory_events.load(std::memory_order_relaxed);
+        stats.uptime_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_created).count();
+        if (stats.uptime_seconds > 0)
+        {
+            stats.lifetime_allocations_per_second = stats.allocations / stats.uptime_seconds;
+            stats.lifetime_deallocations_per_second = stats.deallocations / stats.uptime_seconds;
+        }
+#ifdef GP_POOL_CALLSITE_SAMPLING
+        m_callsite_lock.lock();
+        for (const auto& site : m_callsites)
+        {
+            if (site.file != nullptr)
+            {
+                stats.callsites.push_back(site);
+            }
+        }
+        m_callsite_lock.unlock();
+        std::sort(stats.callsites.begin(), stats.callsites.end(),
+                  [](const HazardPoolStats::callsite& lhs, const HazardPoolStats::callsite& rhs) { return lhs.bytes > rhs.bytes; });
+#endif
+        return stats;
+    }
+
+    private:
+    struct chunk_header
+    {
+        const HazardMemoryPool* owner;
+        chunk_header* next = nullptr;
+        /// Bytes carved from the payload, atomic only for the debug range check
+        std::atomic<std::size_t> bump{0};
+        /// Blocks handed out of the slab, including the ones sitting in magazines
+        std::size_t live_blocks = 0;
+        bool purged = false;
+        /// Mapped with MAP_HUGETLB, pages can only be dropped in whole huge pages
+        bool huge_tlb = false;
+        uint8_t block_class[elements] = {};
+#ifndef NDEBUG
+        std::atomic<uint64_t> allocated[(elements + 63) / 64] = {};
+#endif
+
+        explicit chunk_header(const HazardMemoryPool* owner) : owner(owner) {}
+
+        uint8_t* payload()
+        {
+            return reinterpret_cast<uint8_t*>(this) + payload_offset;
+        }
+    };
+
+    static constexpr std::size_t page_size = 4096;
+    static constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+    /// Payload starts on its own page so purging it never touches the header
+    static constexpr std::size_t payload_offset = (sizeof(chunk_header) + page_size - 1) / page_size * page_size;
+    static constexpr std::size_t chunk_bytes = std::size_t(1) << ceil_log2(payload_offset + elements * granule_size);
+
+    struct magazine
+    {
+        std::size_t count = 0;
+        uint8_t* blocks[magazine_size];
+        magazine* next = nullptr;
+    };
+
+    /// Single writer counters: the owning thread (or the m_lock holder) bumps them with plain
+    /// relaxed load + store, get_stats() reads them from any thread
+    struct usage_counters
+    {
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> deallocations{0};
+        std::atomic<uint64_t> allocated_objects{0};
+        std::atomic<uint64_t> deallocated_objects{0};
+        std::atomic<uint64_t> allocated_bytes{0};
+        std::atomic<uint64_t> deallocated_bytes{0};
+        std::atomic<uint64_t> allocated_block_bytes{0};
+        std::atomic<uint64_t> deallocated_block_bytes{0};
+
+        static void bump(std::atomic<uint64_t>& counter, uint64_t delta)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+
+        /// Returns whether this allocation is picked for callsite sampling
+        bool on_allocate(std::size_t bytes, std::size_t block_bytes)
+        {
+            bump(allocations, 1);
+            bump(allocated_objects, bytes / sizeof(T));
+            bump(allocated_bytes, bytes);
+            bump(allocated_block_bytes, block_bytes);
+#ifdef GP_POOL_CALLSITE_SAMPLING
+            return allocations.load(std::memory_order_relaxed) % GP_POOL_CALLSITE_SAMPLE_RATE == 0;
+#else
+            return false;
+#endif
+        }
+
+        void on_deallocate(std::size_t bytes, std::size_t block_bytes)
+        {
+            bump(deallocations, 1);
+            bump(deallocated_objects, bytes / sizeof(T));
+            bump(deallocated_bytes, bytes);
+            bump(deallocated_block_bytes, block_bytes);
+        }
+    };
+
+    struct alignas(gp::cache_line_size) thread_cache
+    {
+        magazine* loaded = nullptr;
+        magazine* previous = nullptr;
+        /// Whether the owning thread registered its exit flush (owner only)
+        bool registered = false;
+        usage_counters counters;
+    };
+
+#ifdef GP_POOL_CALLSITE_SAMPLING
+    static constexpr std::size_t callsite_slots = 64;
+
+    void record_callsite(const char* file, int line, const char* label, std::size_t bytes)
+    {
+        const std::size_t hash = std::hash<const char*>{}(file) ^ (static_cast<std::size_t>(line) * 0x9e3779b97f4a7c15ull);
+        m_callsite_lock.lock();
+        for (std::size_t probe = 0; probe < callsite_slots; ++probe)
+        {
+            HazardPoolStats::callsite& site = m_callsites[(hash + probe) % callsite_slots];
+            if (site.file == nullptr)
+            {
+                site.file = file;
+                site.line = line;
+                site.label = label;
+            }
+            if (site.file == file && site.line == line)
+            {
+                ++site.samples;
+                site.bytes += bytes;
+                break;
+            }
+        }
+        // Table full: the sample is dropped
+        m_callsite_lock.unlock();
+    }
+#endif
+
+    void register_thread_cache(thread_cache& cache)
+    {
+        if (!cache.registered)
+        {
+            cache.registered = true;
+            HazardThreadIndex::on_thread_exit(&HazardMemoryPool::flush_thread_cache, this);
+        }
+    }
+
+    /// Exit hook: give the dying thread's magazines back before its index is recycled
+    static void flush_thread_cache(void* owner, std::size_t index)
+    {
+        auto* pool = static_cast<HazardMemoryPool*>(owner);
+        thread_cache& cache = pool->m_thread_caches[index];
+        pool->m_lock.lock();
+        for (magazine* mag : {cache.loaded, cache.previous})
+        {
+            if (mag == nullptr)
+            {
+                continue;
+            }
+            if (mag->count == magazine_size && pool->m_full_count < depot_capacity)
+            {
+                push_magazine(pool->m_full_magazines, mag);
+                ++pool->m_full_count;
+                continue;
+            }
+            for (std::size_t i = 0; i < mag->count; ++i)
+            {
+                pool->release_block(mag->blocks[i]);
+            }
+            mag->count = 0;
+            push_magazine(pool->m_empty_magazines, mag);
+        }
+        cache.loaded = nullptr;
+        cache.previous = nullptr;
+        cache.registered = false;
+        pool->m_lock.unlock();
+    }
+
+    uint8_t* allocate_cached(thread_cache& cache)
+    {
+        if (cache.loaded == nullptr || cache.loaded->count == 0)
+        {
+            if (cache.previous != nullptr && cache.previous->count > 0)
+            {
+                std::swap(cache.loaded, cache.previous);
+            }
+            else if (!refill(cache))
+            {
+                return nullptr;
+            }
+        }
+        return cache.loaded->blocks[--cache.loaded->count];
+    }
+
+    void deallocate_cached(thread_cache& cache, uint8_t* block)
+    {
+        if (cache.loaded == nullptr || cache.loaded->count == magazine_size)
+        {
+            if (cache.previous != nullptr && cache.previous->count == 0)
+            {
+                std::swap(cache.loaded, cache.previous);
+            }
+            else
+            {
+                swap_out_full(cache);
+            }
+        }
+        cache.loaded->blocks[cache.loaded->count++] = block;
+    }
+
+    /// Make cache.loaded non-empty: take a full magazine from the depot or fill one from the slab
+    bool refill(thread_cache& cache)
+    {
+        m_lock.lock();
+        if (m_full_magazines != nullptr)
+        {
+            magazine* full = m_full_magazines;
+            m_full_magazines = full->next;
+            --m_full_count;
+            if (cache.previous != nullptr)
+            {
+                push_magazine(m_empty_magazines, cache.previous);
+            }
+            cache.previous = cache.loaded;
+            cache.loaded = full;
+            m_lock.unlock();
+            return true;
+        }
+        if (cache.loaded == nullptr)
+        {
+            cache.loaded = take_empty_magazine();
+        }
+        while (cache.loaded->count < magazine_size / 2)
+        {
+            uint8_t* block = allocate_block(0);
+            if (block == nullptr)
+            {
+                break;
+            }
+            cache.loaded->blocks[cache.loaded->count++] = block;
+        }
+        m_lock.unlock();
+        return cache.loaded->count > 0;
+    }
+
+    /// Hand cache.previous (full) to the depot and load an empty magazine
+    void swap_out_full(thread_cache& cache)
+    {
+        m_lock.lock();
+        if (cache.previous != nullptr)
+        {
+            if (m_full_count < depot_capacity)
+            {
+                push_magazine(m_full_magazines, cache.previous);
+                ++m_full_count;
+            }
+            else
+            {
+                for (std::size_t i = 0; i < cache.previous->count; ++i)
+                {
+                    release_block(cache.previous->blocks[i]);
+                }
+                cache.previous->count = 0;
+                push_magazine(m_empty_magazines, cache.previous);
+            }
+        }
+        cache.previous = cache.loaded;
+        cache.loaded = take_empty_magazine();
+        m_lock.unlock();
+    }
+
+    static void push_magazine(magazine*& list, magazine* mag)
+    {
+        mag->next = list;
+        list = mag;
+    }
+
+    /// Must hold m_lock
+    magazine* take_empty_magazine()
+    {
+        if (m_empty_magazines == nullptr)
+        {
+            return new magazine();
+        }
+        magazine* mag = m_empty_magazines;
+        m_empty_magazines = mag->next;
+        mag->next = nullptr;
+        return mag;
+    }
+
+    static void delete_magazines(magazine* list)
+    {
+        while (list != nullptr)
+        {
+            magazine* next = list->next;
+            delete list;
+            list = next;
+        }
+    }
+
+    static std::size_t size_class_of(std::size_t obj_count)
+    {
+        const std::size_t bytes = (obj_count == 0 ? 1 : obj_count) * sizeof(T);
+        return ceil_log2((bytes + granule_size - 1) / granule_size);
+    }
+
+    static chunk_header* chunk_of(const uint8_t* block)
+    {
+        return reinterpret_cast<chunk_header*>(reinterpret_cast<std::uintptr_t>(block) & ~(chunk_bytes - 1));
+    }
+
+    static std::size_t granule_of(chunk_header* chunk, const uint8_t* block)
+    {
+        return static_cast<std::size_t>(block - chunk->payload()) / granule_size;
+    }
+
+    /// Slab allocation, must hold m_lock
+    uint8_t* allocate_block(std::size_t size_class)
+    {
+        uint8_t* block = pop_free_block(size_class);
+        if (block == nullptr && (m_current == nullptr || (block = carve(m_current, size_class)) == nullptr))
+        {
+            block = split_free_block(size_class);
+            if (block == nullptr)
+            {
+                chunk_header* chunk = acquire_chunk();
+                if (chunk == nullptr)
+                {
+                    return nullptr;
+                }
+                m_current = chunk;
+                block = carve(chunk, size_class);
+            }
+        }
+        ++chunk_of(block)->live_blocks;
+        return block;
+    }
+
+    /// Slab deallocation, must hold m_lock
+    void release_block(uint8_t* block)
+    {
+        chunk_header* chunk = chunk_of(block);
+        push_free_block(block, chunk->block_class[granule_of(chunk, block)]);
+        if (--chunk->live_blocks == 0)
+        {
+            reset_chunk(chunk);
+        }
+    }
+
+    uint8_t* carve(chunk_header* chunk, std::size_t size_class)
+    {
+        const std::size_t block_bytes = granule_size << size_class;
+        const std::size_t offset = chunk->bump.load(std::memory_order_relaxed);
+        if (offset + block_bytes > elements * granule_size)
+        {
+            return nullptr;
+        }
+        chunk->block_class[offset / granule_size] = static_cast<uint8_t>(size_class);
+        chunk->bump.store(offset + block_bytes, std::memory_order_relaxed);
+        const std::size_t carved = nextIndex.fetch_add(block_bytes, std::memory_order_relaxed) + block_bytes;
+        m_high_water_bytes = std::max(m_high_water_bytes, carved);
+        return chunk->payload() + offset;
+    }
+
+    /// All blocks of chunk are on the free lists: pull them off and park the chunk
+    void reset_chunk(chunk_header* chunk)
+    {
+        const std::size_t carved = chunk->bump.load(std::memory_order_relaxed);
+        for (std::size_t offset = 0; offset < carved; )
+        {
+            const std::size_t size_class = chunk->block_class[offset / granule_size];
+            unlink_free_block(reinterpret_cast<free_block*>(chunk->payload() + offset), size_class);
+            offset += granule_size << size_class;
+        }
+        chunk->bump.store(0, std::memory_order_relaxed);
+        nextIndex.fetch_sub(carved, std::memory_order_relaxed);
+        if (chunk == m_current)
+        {
+            return;
+        }
+        if (m_parked_count < m_config.retained_chunks)
+        {
+            ++m_parked_count;
+            chunk->next = m_parked_chunks;
+            m_parked_chunks = chunk;
+        }
+        else if (purge_chunk(chunk))
+        {
+            chunk->next = m_purged_chunks;
+            m_purged_chunks = chunk;
+            ++m_purged_count;
+        }
+        else
+        {
+            // Nothing could be returned to the OS, keep it ready for reuse like a parked chunk
+            ++m_parked_count;
+            chunk->next = m_parked_chunks;
+            m_parked_chunks = chunk;
+        }
+    }
+
+    /// A parked chunk if there is one, otherwise a purged one, otherwise a freshly mapped one
+    chunk_header* acquire_chunk()
+    {
+        chunk_header* chunk = nullptr;
+        if (m_parked_chunks != nullptr)
+        {
+            chunk = m_parked_chunks;
+            m_parked_chunks = chunk->next;
+            --m_parked_count;
+        }
+        else if (m_purged_chunks != nullptr)
+        {
+            chunk = m_purged_chunks;
+            m_purged_chunks = chunk->next;
+            chunk->purged = false;
+            --m_purged_count;
+        }
+        else
+        {
+            bool huge_tlb = false;
+            void* memory = map_chunk(huge_tlb);
+            if (memory == nullptr)
+            {
+                return nullptr;
+            }
+            chunk = new (memory) chunk_header(this);
+            chunk->huge_tlb = huge_tlb;
+            m_chunks.push_back(chunk);
+        }
+        chunk->next = nullptr;
+        return chunk;
+    }
+
+    /// @param huge_tlb Set when the chunk is backed by MAP_HUGETLB pages
+    void* map_chunk(bool& huge_tlb)
+    {
+        huge_tlb = false;
+#ifdef GP_POOL_HAS_MMAP
+        const std::size_t length = 2 * chunk_bytes;
+        void* raw = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (m_config.huge_pages && chunk_bytes % huge_page_size == 0)
+        {
+            raw = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            huge_tlb = raw != MAP_FAILED;
+        }
+#endif
+        if (raw == MAP_FAILED)
+        {
+            raw = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        }
+        if (raw == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        // Over-map and trim so the chunk is aligned to its own size
+        const std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw);
+        const std::uintptr_t aligned = (start + chunk_bytes - 1) & ~(chunk_bytes - 1);
+        if (aligned > start)
+        {
+            munmap(raw, aligned - start);
+        }
+        if (start + length > aligned + chunk_bytes)
+        {
+            munmap(reinterpret_cast<void*>(aligned + chunk_bytes), start + length - (aligned + chunk_bytes));
+        }
+#ifdef MADV_HUGEPAGE
+        if (m_config.huge_pages)
+        {
+            madvise(reinterpret_cast<void*>(aligned), chunk_bytes, MADV_HUGEPAGE);
+        }
+#endif
+        return reinterpret_cast<void*>(aligned);
+#else
+        return ::operator new(chunk_bytes, std::align_val_t(chunk_bytes), std::nothrow);
+#endif
+    }
+
+    static void unmap_chunk(chunk_header* chunk)
+    {
+        chunk->~chunk_header();
+#ifdef GP_POOL_HAS_MMAP
+        munmap(chunk, chunk_bytes);
+#else
+        ::operator delete(chunk, std::align_val_t(chunk_bytes));
+#endif
+    }
+
+    /// Give the payload pages back to the OS, the mapping (and the header) stays
+    /// A MAP_HUGETLB chunk only drops the huge pages past the one holding the header.
+    /// @return False when nothing was returned (madvise failed, or no whole huge page to drop)
+    static bool purge_chunk(chunk_header* chunk)
+    {
+#ifdef GP_POOL_HAS_MMAP
+        const std::size_t start = chunk->huge_tlb ? (payload_offset + huge_page_size - 1) / huge_page_size * huge_page_size : payload_offset;
+        if (start >= chunk_bytes ||
+            madvise(reinterpret_cast<uint8_t*>(chunk) + start, chunk_bytes - start, MADV_DONTNEED) != 0)
+        {
+            return false;
+        }
+        chunk->purged = true;
+        return true;
+#else
+        (void)chunk;
+        return false;
+#endif
+    }
+
+    uint8_t* pop_free_block(std::size_t size_class)
+    {
+        free_block* block = m_free_lists[size_class];
+        if (block == nullptr)
+        {
+            return nullptr;
+        }
+        unlink_free_block(block, size_class);
+        return reinterpret_cast<uint8_t*>(block);
+    }
+
+    void push_free_block(uint8_t* block, std::size_t size_class)
+    {
+        free_block* node = new (block) free_block;
+        m_free_list_bytes += granule_size << size_class;
+        node->prev = nullptr;
+        node->next = m_free_lists[size_class];
+        if (node->next != nullptr)
+        {
+            node->next->prev = node;
+        }
+        m_free_lists[size_class] = node;
+    }
+
+    void unlink_free_block(free_block* node, std::size_t size_class)
+    {
+        m_free_list_bytes -= granule_size << size_class;
+        if (node->prev != nullptr)
+        {
+            node->prev->next = node->next;
+        }
+        else
+        {
+            m_free_lists[size_class] = node->next;
+        }
+        if (node->next != nullptr)
+        {
+            node->next->prev = node->prev;
+        }
+    }
+
+    /// Take the smallest larger free block and halve it down to size_class
+    uint8_t* split_free_block(std::size_t size_class)
+    {
+        for (std::size_t larger = size_class + 1; larger < size_classes; ++larger)
+        {
+            uint8_t* block = pop_free_block(larger);
+            if (block == nullptr)
+            {
+                continue;
+            }
+            chunk_header* chunk = chunk_of(block);
+            // The halves stay on the free lists, they do not count as live
+            while (larger > size_class)
+            {
+                --larger;
+                uint8_t* upper_half = block + (granule_size << larger);
+                chunk->block_class[granule_of(chunk, upper_half)] = static_cast<uint8_t>(larger);
+                push_free_block(upper_half, larger);
+            }
+            chunk->block_class[granule_of(chunk, block)] = static_cast<uint8_t>(size_class);
+            return block;
+        }
+        return nullptr;
+    }
+
+#ifndef NDEBUG
+    /// Flips the live bit of block, returns whether it was in the opposite state
+    static bool mark_allocated(const uint8_t* block, bool allocated)
+    {
+        chunk_header* chunk = chunk_of(block);
+        const std::size_t granule = granule_of(chunk, block);
+        const uint64_t bit = uint64_t(1) << (granule % 64);
+        const uint64_t previous = allocated ? chunk->allocated[granule / 64].fetch_or(bit)
+                                            : chunk->allocated[granule / 64].fetch_and(~bit);
+        return ((previous & bit) != 0) != allocated;
+    }
+#endif
+
+    HazardPoolConfig m_config;
+    thread_cache m_thread_caches[cached_threads];
+    gp::spinlock m_lock;
+    magazine* m_full_magazines = nullptr;
+    magazine* m_empty_magazines = nullptr;
+    std::size_t m_full_count = 0;
+    free_block* m_free_lists[size_classes] = {};
+    std::vector<chunk_header*> m_chunks;
+    chunk_header* m_current = nullptr;
+    chunk_header* m_parked_chunks = nullptr;
+    chunk_header* m_purged_chunks = nullptr;
+    std::size_t m_parked_count = 0;
+    std::size_t m_purged_count = 0;
+    std::size_t m_free_list_bytes = 0;
+    std::size_t m_high_water_bytes = 0;
+    usage_counters m_uncached_counters;
+    std::atomic<uint64_t> m_out_of_memory_events{0};
+    std::chrono::steady_clock::time_point m_created;
+#ifdef GP_POOL_CALLSITE_SAMPLING
+    gp::spinlock m_callsite_lock;
+    HazardPoolStats::callsite m_callsites[callsite_slots] = {};
+#endif
+};
+
+
+/// @brief The pools of a HazardAllocator and of every allocator copied or converted from it
+/// One pool per pool type, created on first use, so HazardAllocator<U>(HazardAllocator<T>(a))
+/// draws from the same pool as a.
+class HazardPoolFamily
+{
+    public:
+    template <class Pool>
+    std::shared_ptr<Pool> pool()
+    {
+        m_lock.lock();
+        std::shared_ptr<Pool> found = find<Pool>();
+        m_lock.unlock();
+        if (found != nullptr)
+        {
+            return found;
+        }
+        // Built outside the lock, another thread may have registered one meanwhile
+        std::shared_ptr<Pool> created = std::make_shared<Pool>();
+        m_lock.lock();
+        found = find<Pool>();
+        if (found == nullptr)
+        {
+            m_pools.push_back({&key<Pool>, created});
+            found = created;
+        }
+        m_lock.unlock();
+        return found;
+    }
+
+    private:
+    template <class Pool>
+    static constexpr char key = 0;
+
+    struct entry
+    {
+        const void* key;
+        std::shared_ptr<void> pool;
+    };
+
+    template <class Pool>
+    std::shared_ptr<Pool> find() const
+    {
+        for (const entry& candidate : m_pools)
+        {
+            if (candidate.key == &key<Pool>)
+            {
+                return std::static_pointer_cast<Pool>(candidate.pool);
+            }
+        }
+        return nullptr;
+    }
+
+    gp::spinlock m_lock;
+    std::vector<entry> m_pools;
 };
 
 
+/// @brief Standard allocator over a HazardMemoryPool
+/// Copies share one pool (held by std::shared_ptr) and compare equal, so a container can free
+/// through a copied, moved or propagated allocator what the original allocated. Allocators
+/// converted from each other (rebinds) share a HazardPoolFamily and compare equal as well.
 template <class T, std::size_t growSize = 1024>
 class HazardAllocator 
 {
+    template <class U, std::size_t>
+    friend class HazardAllocator;
+
+    std::shared_ptr<HazardPoolFamily> m_family;
+
     public:
-        HazardMemoryPool<T, growSize> memory_pool;
+        typedef HazardMemoryPool<T, growSize> pool_type;
+        std::shared_ptr<pool_type> memory_pool;
         typedef std::size_t size_type;
         typedef std::ptrdiff_t difference_type;
         typedef T* pointer;
@@ -85,23 +1545,51 @@ class HazardAllocator
             typedef HazardAllocator<U, growSize> other;
         };
 
-        HazardAllocator() throw() = default;
+        typedef std::true_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+        typedef std::false_type is_always_equal;
 
-        HazardAllocator(HazardAllocator &allocator) throw() {}
+        HazardAllocator()
+            : m_family(std::make_shared<HazardPoolFamily>()), memory_pool(m_family->pool<pool_type>()) {}
+
+        /// Shares the pool, also used for moves so a moved-from container keeps a usable allocator
+        HazardAllocator(const HazardAllocator &allocator) throw()
+            : m_family(allocator.m_family), memory_pool(allocator.memory_pool) {}
 
         template <class U>
-        HazardAllocator(const HazardAllocator<U, growSize> &other) throw() {}
+        HazardAllocator(const HazardAllocator<U, growSize> &other)
+            : m_family(other.m_family), memory_pool(m_family->pool<pool_type>()) {}
+
+        HazardAllocator& operator=(const HazardAllocator &allocator) throw()
+        {
+            m_family = allocator.m_family;
+            memory_pool = allocator.memory_pool;
+            return *this;
+        }
 
         ~HazardAllocator() {}
 
-        pointer allocate(size_type n, const void *hint = 0)
+        template <class U>
+        bool operator==(const HazardAllocator<U, growSize> &other) const
+        {
+            return m_family == other.m_family;
+        }
+
+        template <class U>
+        bool operator!=(const HazardAllocator<U, growSize> &other) const
         {
-           return memory_pool.allocate(n);
+            return !(*this == other);
+        }
+
+        pointer allocate(size_type n, const void *hint = 0 GP_POOL_CALLSITE_PARAMS)
+        {
+           return memory_pool->allocate(n GP_POOL_CALLSITE_ARGS);
         }
 
         void deallocate(pointer p, size_type n)
         {
-            memory_pool.deallocate(p);
+            memory_pool->deallocate(p, n);
         }
 
         void construct(pointer p, const_reference val)
@@ -115,9 +1603,27 @@ class HazardAllocator
             p->~T();
         }
 
+        /// @brief Destroy and deallocate p once no HazardPointer protects it
+        /// The retired node holds its own reference to the pool, so the pool outlives the
+        /// reclamation even if every allocator copy is gone by then.
+        void retire(pointer p)
+        {
+            HazardPointerDomain::instance().retire(p, [](void* object, void* pool) {
+                auto* handle = static_cast<std::shared_ptr<pool_type>*>(pool);
+                static_cast<pointer>(object)->~T();
+                (*handle)->deallocate(static_cast<pointer>(object));
+                delete handle;
+            }, new std::shared_ptr<pool_type>(memory_pool));
+        }
+
         const size_t get_index()
         {
-            return memory_pool.nextIndex.load();
+            return memory_pool->nextIndex.load();
+        }
+
+        HazardPoolStats get_stats()
+        {
+            return memory_pool->get_stats();
         }
 };
 #endif
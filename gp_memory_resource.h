@@ -0,0 +1,281 @@
+#ifndef _GP_MEMORY_RESOURCE_H_
+#define _GP_MEMORY_RESOURCE_H_
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+#include "gp_hazard_allocator.h"
+
+namespace gp {
+
+namespace detail {
+
+/// @brief Allocations too large (or too aligned) for a pool, forwarded to the upstream resource
+/// A small header in front of every block links it into a list, so release() can free them all.
+class oversize_list {
+public:
+    explicit oversize_list(std::pmr::memory_resource* upstream) : m_upstream(upstream) {}
+
+    oversize_list(const oversize_list&) = delete;
+    oversize_list& operator=(const oversize_list&) = delete;
+
+    ~oversize_list() { release(); }
+
+    void* allocate(std::size_t bytes, std::size_t alignment) {
+        const std::size_t offset = header_offset(alignment);
+        auto* base = static_cast<unsigned char*>(m_upstream->allocate(bytes + offset, upstream_alignment(alignment)));
+        auto* header = reinterpret_cast<block_header*>(base + offset - sizeof(block_header));
+        header->bytes = bytes;
+        header->alignment = alignment;
+        header->prev = nullptr;
+        header->next = m_head;
+        if (m_head != nullptr) {
+            m_head->prev = header;
+        }
+        m_head = header;
+        return base + offset;
+    }
+
+    void deallocate(void* pointer) {
+        auto* header = reinterpret_cast<block_header*>(static_cast<unsigned char*>(pointer) - sizeof(block_header));
+        if (header->prev != nullptr) {
+            header->prev->next = header->next;
+        } else {
+            m_head = header->next;
+        }
+        if (header->next != nullptr) {
+            header->next->prev = header->prev;
+        }
+        free_block(header);
+    }
+
+    void release() {
+        while (m_head != nullptr) {
+            block_header* next = m_head->next;
+            free_block(m_head);
+            m_head = next;
+        }
+    }
+
+    std::pmr::memory_resource* upstream_resource() const { return m_upstream; }
+
+private:
+    struct block_header {
+        block_header* prev;
+        block_header* next;
+        std::size_t bytes;
+        std::size_t alignment;
+    };
+
+    static std::size_t upstream_alignment(std::size_t alignment) {
+        return alignment > alignof(block_header) ? alignment : alignof(block_header);
+    }
+
+    static std::size_t header_offset(std::size_t alignment) {
+        const std::size_t align = upstream_alignment(alignment);
+        return (sizeof(block_header) + align - 1) / align * align;
+    }
+
+    void free_block(block_header* header) {
+        const std::size_t offset = header_offset(header->alignment);
+        unsigned char* base = reinterpret_cast<unsigned char*>(header) + sizeof(block_header) - offset;
+        m_upstream->deallocate(base, header->bytes + offset, upstream_alignment(header->alignment));
+    }
+
+    std::pmr::memory_resource* m_upstream;
+    block_header* m_head = nullptr;
+};
+
+/// @brief Unit the gp pool resources hand out, 16 bytes aligned like malloc
+struct alignas(16) pool_granule {
+    unsigned char bytes[16];
+};
+
+inline std::size_t granules_for(std::size_t bytes) {
+    return (bytes + sizeof(pool_granule) - 1) / sizeof(pool_granule);
+}
+
+} // namespace detail
+
+
+/// @brief Thread-safe std::pmr::memory_resource drawing from a HazardMemoryPool
+/// Requests are rounded up to 16 byte granules and served by the pool's size classes (per-thread
+/// magazines for single granules, mmap-backed chunks behind them). Requests larger than a chunk
+/// block or aligned beyond 16 bytes go to the upstream resource.
+/// release() frees everything at once; like std::pmr pools it must not race with other calls.
+/// @tparam granules_per_chunk Pool chunk size in 16 byte granules
+template <std::size_t granules_per_chunk = 4096>
+class basic_pool_resource : public std::pmr::memory_resource {
+    using granule = detail::pool_granule;
+    using pool_type = HazardMemoryPool<granule, granules_per_chunk>;
+
+public:
+    static constexpr std::size_t max_pooled_bytes = sizeof(granule) * pool_type::max_block_granules;
+
+    explicit basic_pool_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+                                 const HazardPoolConfig& config = HazardPoolConfig())
+        : m_config(config), m_pool(std::make_unique<pool_type>(config)), m_oversize(upstream) {}
+
+    basic_pool_resource(const basic_pool_resource&) = delete;
+    basic_pool_resource& operator=(const basic_pool_resource&) = delete;
+
+    /// @brief Frees every allocation made through this resource
+    void release() {
+        m_pool = std::make_unique<pool_type>(m_config);
+        m_oversize.release();
+    }
+
+    std::pmr::memory_resource* upstream_resource() const { return m_oversize.upstream_resource(); }
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        if (!pooled(bytes, alignment)) {
+            m_oversize_lock.lock();
+            void* pointer = m_oversize.allocate(bytes, alignment);
+            m_oversize_lock.unlock();
+            return pointer;
+        }
+        return m_pool->allocate(detail::granules_for(bytes));
+    }
+
+    void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override {
+        if (!pooled(bytes, alignment)) {
+            m_oversize_lock.lock();
+            m_oversize.deallocate(pointer);
+            m_oversize_lock.unlock();
+            return;
+        }
+        m_pool->deallocate(static_cast<granule*>(pointer), detail::granules_for(bytes));
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    static bool pooled(std::size_t bytes, std::size_t alignment) {
+        return bytes <= max_pooled_bytes && alignment <= alignof(granule);
+    }
+
+    HazardPoolConfig m_config;
+    std::unique_ptr<pool_type> m_pool;
+    spinlock m_oversize_lock;
+    detail::oversize_list m_oversize;
+};
+
+using pool_resource = basic_pool_resource<>;
+
+
+/// @brief Single-threaded variant of basic_pool_resource
+/// Same size classes and chunks, but allocations go straight to the pool's slab without the
+/// lock or the per-thread magazines (HazardMemoryPool::allocate_unsynchronized). Freed blocks
+/// are reused in O(1). Must only be used by one thread at a time.
+/// @tparam granules_per_chunk Pool chunk size in 16 byte granules
+template <std::size_t granules_per_chunk = 4096>
+class basic_unsynchronized_pool_resource : public std::pmr::memory_resource {
+    using granule = detail::pool_granule;
+    using pool_type = HazardMemoryPool<granule, granules_per_chunk>;
+
+public:
+    static constexpr std::size_t max_pooled_bytes = sizeof(granule) * pool_type::max_block_granules;
+
+    explicit basic_unsynchronized_pool_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+                                                const HazardPoolConfig& config = HazardPoolConfig())
+        : m_config(config), m_pool(std::make_unique<pool_type>(config)), m_oversize(upstream) {}
+
+    basic_unsynchronized_pool_resource(const basic_unsynchronized_pool_resource&) = delete;
+    basic_unsynchronized_pool_resource& operator=(const basic_unsynchronized_pool_resource&) = delete;
+
+    /// @brief Frees every allocation made through this resource
+    void release() {
+        m_pool = std::make_unique<pool_type>(m_config);
+        m_oversize.release();
+    }
+
+    std::pmr::memory_resource* upstream_resource() const { return m_oversize.upstream_resource(); }
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        if (bytes > max_pooled_bytes || alignment > alignof(granule)) {
+            return m_oversize.allocate(bytes, alignment);
+        }
+        return m_pool->allocate_unsynchronized(detail::granules_for(bytes));
+    }
+
+    void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override {
+        if (bytes > max_pooled_bytes || alignment > alignof(granule)) {
+            m_oversize.deallocate(pointer);
+            return;
+        }
+        m_pool->deallocate_unsynchronized(static_cast<granule*>(pointer), detail::granules_for(bytes));
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    HazardPoolConfig m_config;
+    std::unique_ptr<pool_type> m_pool;
+    detail::oversize_list m_oversize;
+};
+
+using unsynchronized_pool_resource = basic_unsynchronized_pool_resource<>;
+
+
+/// @brief Bump-only resource over HazardMemoryPool chunks (not thread-safe)
+/// Each request takes exactly the granules it needs from the current chunk
+/// (HazardMemoryPool::allocate_bump); deallocate() is a no-op and memory comes back only through
+/// release() or destruction, when the chunks are unmapped. Requests larger than a chunk or
+/// aligned beyond 16 bytes go to the upstream resource.
+/// Suited to request scoped containers that are thrown away as a whole.
+/// @tparam granules_per_chunk Pool chunk size in 16 byte granules
+template <std::size_t granules_per_chunk = 4096>
+class basic_monotonic_resource : public std::pmr::memory_resource {
+    using granule = detail::pool_granule;
+    using pool_type = HazardMemoryPool<granule, granules_per_chunk>;
+
+public:
+    static constexpr std::size_t max_pooled_bytes = sizeof(granule) * granules_per_chunk;
+
+    explicit basic_monotonic_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+                                      const HazardPoolConfig& config = HazardPoolConfig())
+        : m_config(config), m_pool(std::make_unique<pool_type>(config)), m_oversize(upstream) {}
+
+    basic_monotonic_resource(const basic_monotonic_resource&) = delete;
+    basic_monotonic_resource& operator=(const basic_monotonic_resource&) = delete;
+
+    /// @brief Frees every allocation made through this resource
+    void release() {
+        m_pool = std::make_unique<pool_type>(m_config);
+        m_oversize.release();
+    }
+
+    std::pmr::memory_resource* upstream_resource() const { return m_oversize.upstream_resource(); }
+
+protected:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        if (bytes > max_pooled_bytes || alignment > alignof(granule)) {
+            return m_oversize.allocate(bytes, alignment);
+        }
+        return m_pool->allocate_bump(detail::granules_for(bytes));
+    }
+
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    HazardPoolConfig m_config;
+    std::unique_ptr<pool_type> m_pool;
+    detail::oversize_list m_oversize;
+};
+
+using monotonic_resource = basic_monotonic_resource<>;
+
+} // namespace gp
+
+#endif
@@ -0,0 +1,336 @@
+#ifndef _GP_MPMC_QUEUE_H_
+#define _GP_MPMC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "gp_atomic.h"
+
+namespace gp {
+
+   /// @brief Bounded multi producer / multi consumer ring queue (Vyukov)
+   /// Every cell carries a sequence number: sequence == position means the cell is free for the
+   /// producer of that position, sequence == position + 1 means it holds the element for the
+   /// consumer of that position. Producers and consumers only contend on their own padded
+   /// counter (tail / head) and on the cells they claim, never on a lock.
+   /// The try_ operations fail instead of waiting. push() and pop() take a ticket and park on
+   /// their cell's sequence (std::atomic::wait where available, spin then yield otherwise) until
+   /// the cell is ready for them.
+   /// @tparam T The element type, moving it must not throw
+   /// @tparam Alloc Allocator for the cells (std::allocator, a pmr allocator, or HazardAllocator
+   ///         with a growSize of at least the capacity); the same instance frees them
+   template <typename T, typename Alloc = std::allocator<T>>
+   class mpmc_queue
+   {
+      static_assert(std::is_nothrow_move_constructible_v<T>, "mpmc_queue elements must be nothrow move constructible");
+
+      struct cell
+      {
+         std::atomic<std::size_t> sequence;
+         alignas(T) unsigned char storage[sizeof(T)];
+
+         T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+      };
+
+      using cell_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<cell>;
+      using cell_traits = std::allocator_traits<cell_allocator>;
+
+      public:
+      using value_type = T;
+
+      /// @param capacity Number of cells, rounded up to a power of two
+      explicit mpmc_queue(std::size_t capacity, const Alloc& alloc = Alloc())
+         : m_alloc(alloc), m_capacity(round_up(capacity)), m_mask(m_capacity - 1)
+      {
+         m_cells = cell_traits::allocate(m_alloc, m_capacity);
+         if(m_cells == nullptr)
+         {
+            throw std::runtime_error("Out of memory!");
+         }
+         for(std::size_t i = 0; i < m_capacity; ++i)
+         {
+            ::new (static_cast<void*>(&m_cells[i].sequence)) std::atomic<std::size_t>(i);
+         }
+      }
+
+     ~mpmc_queue()
+      {
+         const std::size_t tail = m_tail.value.load(std::memory_order_relaxed);
+         for(std::size_t position = m_head.value.load(std::memory_order_relaxed); position != tail; ++position)
+         {
+            cell& source = m_cells[position & m_mask];
+            if(source.sequence.load(std::memory_order_relaxed) == position + 1)
+               source.value()->~T();
+         }
+         cell_traits::deallocate(m_alloc, m_cells, m_capacity);
+      }
+
+      mpmc_queue(const mpmc_queue&) = delete;
+      mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+      bool try_push(const T& value)
+      {
+         return try_emplace(value);
+      }
+
+      bool try_push(T&& value)
+      {
+         return try_emplace(std::move(value));
+      }
+
+      /// @brief Construct the element in place if a cell is free, false if the queue is full
+      template <typename... Args>
+      bool try_emplace(Args&&... args)
+      {
+         // Built before a cell is claimed, a throwing constructor must not leave a hole behind
+         T value(std::forward<Args>(args)...);
+         std::size_t position = m_tail.value.load(std::memory_order_relaxed);
+         for(;;)
+         {
+            cell& target = m_cells[position & m_mask];
+            const std::size_t sequence = target.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - position);
+            if(difference == 0)
+            {
+               if(m_tail.value.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+               {
+                  publish(target, position, std::move(value));
+                  return true;
+               }
+            }
+            else if(difference < 0)
+            {
+               return false;
+            }
+            else
+            {
+               position = m_tail.value.load(std::memory_order_relaxed);
+            }
+         }
+      }
+
+      /// @brief Move the oldest element into out, false if the queue is empty
+      bool try_pop(T& out)
+      {
+         std::size_t position = m_head.value.load(std::memory_order_relaxed);
+         for(;;)
+         {
+            cell& source = m_cells[position & m_mask];
+            const std::size_t sequence = source.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+            if(difference == 0)
+            {
+               if(m_head.value.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+               {
+                  consume(source, position, out);
+                  return true;
+               }
+            }
+            else if(difference < 0)
+            {
+               return false;
+            }
+            else
+            {
+               position = m_head.value.load(std::memory_order_relaxed);
+            }
+         }
+      }
+
+      /// @brief Push up to count elements from first with a single claim, returns how many were pushed
+      /// Elements are built from *first after the claim, pass a std::move_iterator for types whose copy may throw.
+      template <typename InputIt>
+      std::size_t try_push_n(InputIt first, std::size_t count)
+      {
+         static_assert(std::is_nothrow_constructible_v<T, typename std::iterator_traits<InputIt>::reference>,
+                       "try_push_n needs elements that can be built from *first without throwing");
+         if(count == 0)
+            return 0;
+         std::size_t position = m_tail.value.load(std::memory_order_relaxed);
+         for(;;)
+         {
+            const std::size_t claimed = ready_cells(position, count, 0);
+            if(claimed == 0)
+            {
+               if(static_cast<std::ptrdiff_t>(m_cells[position & m_mask].sequence.load(std::memory_order_acquire) - position) < 0)
+                  return 0;
+               position = m_tail.value.load(std::memory_order_relaxed);
+               continue;
+            }
+            // Cells [position, position + claimed) cannot be claimed by anyone else until tail moves
+            if(m_tail.value.compare_exchange_weak(position, position + claimed, std::memory_order_relaxed))
+            {
+               for(std::size_t i = 0; i < claimed; ++i, ++first)
+               {
+                  publish(m_cells[(position + i) & m_mask], position + i, T(*first));
+               }
+               return claimed;
+            }
+         }
+      }
+
+      /// @brief Pop up to max_count elements into out with a single claim, returns how many were popped
+      template <typename OutputIt>
+      std::size_t try_pop_n(OutputIt out, std::size_t max_count)
+      {
+         if(max_count == 0)
+            return 0;
+         std::size_t position = m_head.value.load(std::memory_order_relaxed);
+         for(;;)
+         {
+            const std::size_t claimed = ready_cells(position, max_count, 1);
+            if(claimed == 0)
+            {
+               if(static_cast<std::ptrdiff_t>(m_cells[position & m_mask].sequence.load(std::memory_order_acquire) - (position + 1)) < 0)
+                  return 0;
+               position = m_head.value.load(std::memory_order_relaxed);
+               continue;
+            }
+            if(m_head.value.compare_exchange_weak(position, position + claimed, std::memory_order_relaxed))
+            {
+               for(std::size_t i = 0; i < claimed; ++i, ++out)
+               {
+                  cell& source = m_cells[(position + i) & m_mask];
+                  *out = std::move(*source.value());
+                  source.value()->~T();
+                  release(source, position + i);
+               }
+               return claimed;
+            }
+         }
+      }
+
+      /// @brief Push, parking while the queue is full
+      template <typename... Args>
+      void push(Args&&... args)
+      {
+         T value(std::forward<Args>(args)...);
+         const std::size_t position = m_tail.value.fetch_add(1, std::memory_order_relaxed);
+         cell& target = m_cells[position & m_mask];
+         wait_for(target.sequence, position);
+         publish(target, position, std::move(value));
+      }
+
+      /// @brief Pop, parking while the queue is empty
+      T pop()
+      {
+         const std::size_t position = m_head.value.fetch_add(1, std::memory_order_relaxed);
+         cell& source = m_cells[position & m_mask];
+         wait_for(source.sequence, position + 1);
+         T value(std::move(*source.value()));
+         source.value()->~T();
+         release(source, position);
+         return value;
+      }
+
+      /// @brief Element count at some recent point (negative transients clamp to 0)
+      std::size_t size_approx() const
+      {
+         const std::size_t tail = m_tail.value.load(std::memory_order_acquire);
+         const std::size_t head = m_head.value.load(std::memory_order_acquire);
+         const std::ptrdiff_t size = static_cast<std::ptrdiff_t>(tail - head);
+         return size < 0 ? 0 : static_cast<std::size_t>(size) > m_capacity ? m_capacity : static_cast<std::size_t>(size);
+      }
+
+      bool empty() const
+      {
+         return size_approx() == 0;
+      }
+
+      std::size_t capacity() const
+      {
+         return m_capacity;
+      }
+
+      private:
+      struct alignas(cache_line_size) padded_counter
+      {
+         std::atomic<std::size_t> value{0};
+      };
+
+      static std::size_t round_up(std::size_t capacity)
+      {
+         std::size_t rounded = 2;
+         while(rounded < capacity)
+            rounded <<= 1;
+         return rounded;
+      }
+
+      /// Number of consecutive cells from position whose sequence is position + i + offset
+      std::size_t ready_cells(std::size_t position, std::size_t limit, std::size_t offset) const
+      {
+         if(limit > m_capacity)
+            limit = m_capacity;
+         std::size_t ready = 0;
+         while(ready < limit && m_cells[(position + ready) & m_mask].sequence.load(std::memory_order_acquire) == position + ready + offset)
+            ++ready;
+         return ready;
+      }
+
+      void publish(cell& target, std::size_t position, T&& value)
+      {
+         ::new (static_cast<void*>(target.storage)) T(std::move(value));
+         target.sequence.store(position + 1, std::memory_order_release);
+         notify(target.sequence);
+      }
+
+      void consume(cell& source, std::size_t position, T& out)
+      {
+         out = std::move(*source.value());
+         source.value()->~T();
+         release(source, position);
+      }
+
+      void release(cell& source, std::size_t position)
+      {
+         source.sequence.store(position + m_capacity, std::memory_order_release);
+         notify(source.sequence);
+      }
+
+      static void wait_for(std::atomic<std::size_t>& sequence, std::size_t expected)
+      {
+         std::size_t current = sequence.load(std::memory_order_acquire);
+#if defined(__cpp_lib_atomic_wait)
+         while(current != expected)
+         {
+            sequence.wait(current, std::memory_order_acquire);
+            current = sequence.load(std::memory_order_acquire);
+         }
+#else
+         for(unsigned spins = 0; current != expected; ++spins)
+         {
+            if(spins < 64)
+               cpu_relax();
+            else
+               std::this_thread::yield();
+            current = sequence.load(std::memory_order_acquire);
+         }
+#endif
+      }
+
+      static void notify(std::atomic<std::size_t>& sequence)
+      {
+#if defined(__cpp_lib_atomic_wait)
+         sequence.notify_all();
+#else
+         (void)sequence;
+#endif
+      }
+
+      cell_allocator m_alloc;
+      const std::size_t m_capacity;
+      const std::size_t m_mask;
+      cell* m_cells;
+      padded_counter m_head;
+      padded_counter m_tail;
+   };
+
+} // namespace gp
+
+#endif
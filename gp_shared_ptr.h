@@ -1,7 +1,12 @@
 #ifndef _ADAPTABLE_SHARED_PTR_H_
 #define _ADAPTABLE_SHARED_PTR_H_
 
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <vector>
 #include "gp_atomic.h"
+#include "gp_epoch_reclaimer.h"
 namespace gp {
    // Shared Pointer Implementation
    // Forward Declarations
@@ -18,30 +23,340 @@ namespace gp {
    template <typename T, typename ref_counter, typename memory_manager>
    class _shared_ptr_;
 
+   template <typename T, typename ref_counter, typename Alloc>
+   class inplace_control_block;
+
+   template <typename T, typename ref_counter, template<typename> typename memory_manager>
+   class atomic_shared_ptr;
+
    /// @brief  Shared Pointer
    /// @tparam T The type of the data
-   /// @tparam ref_counter The reference counter type (atomic(default), semi_atomic, etc.)
+   /// @tparam ref_counter The reference counter type (atomic(default), semi_atomic, biased_ref_counter, etc.)
    /// @tparam memory_manager The memory manager type (reclaimer(default), deleter, etc.)
 
    template <typename T, typename ref_counter = uint32_t, template<typename> typename memory_manager = deleter>
    using shared_ptr = _shared_ptr_<T, ref_counter, memory_manager<control_block<T, ref_counter>>>;
 
+   /// @brief Biased reference counter policy
+   /// The thread that creates the counter (the owner) counts its copies and drops in a plain
+   /// thread-local field; every other thread uses an atomic shared count. When the owner's local
+   /// count drops to zero both counts are merged and the shared count becomes authoritative.
+   /// If another thread drives the shared count negative before that (it dropped a reference the
+   /// owner counted), or to zero while the owner holds no local references, the counter is queued
+   /// to the owner, which merges it on its next biased operation, on drain_queued() or at thread
+   /// exit; if the owner already exited the dropping thread merges it itself. A merge that finds no references left frees the object through the
+   /// release hook installed by the control block.
+   class biased_ref_counter
+   {
+      public:
+      using release_function = void (*)(void* context);
+
+      biased_ref_counter(int32_t initial_count = 1) : m_owner(owner_state::current()), m_local(initial_count)
+      {
+         m_owner->retain();
+      }
+
+     ~biased_ref_counter()
+      {
+         m_owner->release();
+      }
+
+      biased_ref_counter(const biased_ref_counter&) = delete;
+      biased_ref_counter& operator=(const biased_ref_counter&) = delete;
+
+      /// @brief Called when a deferred merge finds the count at zero
+      void bind_release(release_function release, void* context)
+      {
+         m_release = release;
+         m_release_context = context;
+      }
+
+      void increment()
+      {
+         if(owns_local_count())
+         {
+            m_local.store(m_local.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+         }
+         m_shared.fetch_add(count_unit, std::memory_order_relaxed);
+      }
+
+      /// @brief Drops one reference, true when the caller released the last one
+      bool decrement()
+      {
+         if(owns_local_count())
+         {
+            const int32_t local = m_local.load(std::memory_order_relaxed) - 1;
+            m_local.store(local, std::memory_order_relaxed);
+            if(local > 0)
+            {
+               return false;
+            }
+            // The owner lets go: from now on the shared count is authoritative
+            m_merged = true;
+            const int64_t previous = m_shared.fetch_add(merged_flag, std::memory_order_acq_rel);
+            return (previous & queued_flag) == 0 && count_of(previous) == 0;
+         }
+
+         int64_t current = m_shared.load(std::memory_order_relaxed);
+         for(;;)
+         {
+            int64_t next = current - count_unit;
+            // Unmerged and at zero or below: either the owner counted the reference being dropped,
+            // or it holds none (intrusive counts start at 0) and this was the last one
+            const bool enqueue = (current & (merged_flag | queued_flag)) == 0 &&
+                                 (count_of(next) < 0 || (count_of(next) == 0 && m_local.load(std::memory_order_relaxed) == 0));
+            if(enqueue)
+            {
+               next |= queued_flag;
+            }
+            if(m_shared.compare_exchange_weak(current, next, std::memory_order_acq_rel, std::memory_order_relaxed))
+            {
+               if(enqueue)
+               {
+                  m_owner->enqueue(this);
+                  return false;
+               }
+               return (next & merged_flag) != 0 && (next & queued_flag) == 0 && count_of(next) == 0;
+            }
+         }
+      }
+
+      /// @brief Approximate number of references (exact once merged)
+      long use_count() const
+      {
+         const long shared = static_cast<long>(count_of(m_shared.load(std::memory_order_acquire)));
+         return (m_shared.load(std::memory_order_relaxed) & merged_flag) ? shared : shared + m_local.load(std::memory_order_relaxed);
+      }
+
+      /// @brief Merge every counter other threads queued to the calling thread
+      static void drain_queued()
+      {
+         owner_state::current()->drain();
+      }
+
+      private:
+      static constexpr int64_t merged_flag = 1;
+      static constexpr int64_t queued_flag = 2;
+      static constexpr int64_t count_unit = 4;
+
+      static int64_t count_of(int64_t shared)
+      {
+         return shared >> 2;
+      }
+
+      struct owner_state
+      {
+         std::atomic<uint32_t> refs{1};
+         std::atomic<bool> has_queued{false};
+         spinlock lock;
+         bool alive = true;
+         std::vector<biased_ref_counter*> queue;
+
+         struct holder
+         {
+            owner_state* state = new owner_state();
+           ~holder()
+            {
+               state->drain();
+               state->lock.lock();
+               state->alive = false;
+               state->lock.unlock();
+               state->release();
+            }
+         };
+
+         static owner_state* current()
+         {
+            static thread_local holder current_thread;
+            return current_thread.state;
+         }
+
+         void retain()
+         {
+            refs.fetch_add(1, std::memory_order_relaxed);
+         }
+
+         void release()
+         {
+            if(refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+               delete this;
+         }
+
+         void enqueue(biased_ref_counter* counter)
+         {
+            lock.lock();
+            if(!alive)
+            {
+               // The owner exited, its local count is final and visible through the lock
+               lock.unlock();
+               counter->merge();
+               return;
+            }
+            queue.push_back(counter);
+            has_queued.store(true, std::memory_order_release);
+            lock.unlock();
+         }
+
+         void drain()
+         {
+            lock.lock();
+            std::vector<biased_ref_counter*> pending;
+            pending.swap(queue);
+            has_queued.store(false, std::memory_order_relaxed);
+            lock.unlock();
+            for(biased_ref_counter* counter : pending)
+               counter->merge();
+         }
+      };
+
+      /// True on the owner thread until it merged, merges queued counters on the way
+      bool owns_local_count()
+      {
+         if(m_owner != owner_state::current())
+            return false;
+         if(m_owner->has_queued.load(std::memory_order_acquire))
+            m_owner->drain();
+         return !m_merged;
+      }
+
+      /// Folds the local count into the shared one and clears the queued flag
+      void merge()
+      {
+         const int64_t local = m_merged ? 0 : (static_cast<int64_t>(m_local.load(std::memory_order_relaxed)) * count_unit) | merged_flag;
+         m_local.store(0, std::memory_order_relaxed);
+         m_merged = true;
+         int64_t current = m_shared.load(std::memory_order_relaxed);
+         int64_t next;
+         do
+         {
+            next = (current + local) & ~queued_flag;
+         } while(!m_shared.compare_exchange_weak(current, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+         if(count_of(next) == 0 && m_release != nullptr)
+            m_release(m_release_context);
+      }
+
+      owner_state* m_owner;
+      std::atomic<int32_t> m_local;
+      bool m_merged = false;
+      std::atomic<int64_t> m_shared{0};
+      release_function m_release = nullptr;
+      void* m_release_context = nullptr;
+   };
+
+   /// @brief How _shared_ptr_ drives its ref_counter policy
+   /// Plain integers and gp::atomic / gp::semi_atomic use their operators, biased_ref_counter its members.
+   template <typename ref_counter>
+   struct ref_count_ops
+   {
+      static void increment(ref_counter& count) { ++count; }
+
+      /// True when the last reference is gone
+      static bool decrement(ref_counter& count) { return --count == 0; }
+
+      static long use_count(ref_counter& count)
+      {
+         if constexpr (std::is_arithmetic_v<ref_counter>)
+            return static_cast<long>(count);
+         else
+            return static_cast<long>(count.load());
+      }
+   };
+
+   template <>
+   struct ref_count_ops<biased_ref_counter>
+   {
+      static void increment(biased_ref_counter& count) { count.increment(); }
+      static bool decrement(biased_ref_counter& count) { return count.decrement(); }
+      static long use_count(biased_ref_counter& count) { return count.use_count(); }
+   };
+
+   template <typename ref_counter, typename = void>
+   struct has_release_hook : std::false_type {};
+
+   template <typename ref_counter>
+   struct has_release_hook<ref_counter, std::void_t<decltype(std::declval<ref_counter&>().bind_release(nullptr, nullptr))>> : std::true_type {};
+
    // Control Block Implementation
    template <typename T, typename ref_counter = atomic<int>>
    class control_block
    { 
        public:
-       control_block() : ref_count(1), data(nullptr) {}
-       control_block(T&& data) : ref_count(1), data(new T(std::move(data)))   {}
+       /// Frees the block, lets blocks that own their storage (inplace_control_block) free themselves
+       using dispose_function = void (*)(control_block*);
+
+       control_block() : ref_count(1), data(nullptr) { bind_counter(); }
+       control_block(const T& data) : ref_count(1), data(new T(data))   { bind_counter(); }
+       control_block(T&& data) : ref_count(1), data(new T(std::move(data)))   { bind_counter(); }
       ~control_block() 
        { 
-         if(data != nullptr && ref_count == 0) delete data; 
+         if(data != nullptr && ref_count_ops<ref_counter>::use_count(ref_count) == 0) delete data; 
        }
        ref_counter ref_count;
        T* data;
+       dispose_function dispose = [](control_block* cb) { delete cb; };
+
+       private:
+       /// Counters that can hit zero outside of _shared_ptr_ (biased_ref_counter) free the block themselves
+       void bind_counter()
+       {
+          if constexpr (has_release_hook<ref_counter>::value)
+             ref_count.bind_release([](void* context) {
+                auto* cb = static_cast<control_block*>(context);
+                cb->dispose(cb);
+             }, this);
+       }
    };
 
+   /// @brief Control block with T stored inside it (gp::make_shared / gp::allocate_shared)
+   /// One allocation holds the counter and the object, so a deref stays within the block.
+   template <typename T, typename ref_counter, typename Alloc>
+   class inplace_control_block : public control_block<T, ref_counter>
+   {
+       public:
+       using block_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<inplace_control_block>;
+
+       template <typename... Args>
+       inplace_control_block(const Alloc& alloc, Args&&... args) : m_alloc(alloc)
+       {
+          this->data = ::new (static_cast<void*>(m_storage)) T(std::forward<Args>(args)...);
+          this->dispose = &inplace_control_block::dispose_inplace;
+       }
+
+       private:
+       static void dispose_inplace(control_block<T, ref_counter>* cb)
+       {
+          auto* self = static_cast<inplace_control_block*>(cb);
+          if(self->data != nullptr)
+          {
+             self->data->~T();
+             self->data = nullptr;
+          }
+          block_allocator alloc(self->m_alloc);
+          std::allocator_traits<block_allocator>::destroy(alloc, self);
+          std::allocator_traits<block_allocator>::deallocate(alloc, self, 1);
+       }
+
+       Alloc m_alloc;
+       alignas(T) unsigned char m_storage[sizeof(T)];
+   };
+
+   /// @brief Frees a block handed to a memory manager
+   template <typename T>
+   void dispose_block(T* block)
+   {
+      delete block;
+   }
+
+   template <typename T, typename ref_counter>
+   void dispose_block(control_block<T, ref_counter>* cb)
+   {
+      cb->dispose(cb);
+   }
+
    // Reclaimer Implementation
+   /// @brief Memory manager that defers freeing through the gp::epoch_domain
+   /// Blocks are freed once every reader inside an epoch_guard at retire time has left.
    template <typename T>
    class reclaimer
    {
@@ -62,35 +377,27 @@ namespace gp {
 
       static void retire(T* data)
       {
-          get_instance().data[data] = true;
+          if(data != nullptr)
+             epoch_domain::instance().retire(data, [](void* block, void*) { dispose_block(static_cast<T*>(block)); });
       }
 
-      static void retire(const T* cb)
+      static void retire(const T* data)
       {
-          retire(cb);
+          retire(const_cast<T*>(data));
       }
 
+      /// @brief Free whatever became safe to free (the calling thread's and exited threads' retires)
       static void reclaim()
       {
-        for(auto& pair : get_instance().data)
-        {
-           if(pair.second)
-           {
-               delete pair.first;
-               pair.second = false;
-           }
-        }
+          epoch_domain::instance().reclaim();
       }
-    
-      std::unordered_map<T*, bool> data;
+
       private:
       reclaimer() = default;
       reclaimer(const reclaimer&) = delete;
       reclaimer& operator=(const reclaimer&) = delete;
       reclaimer(reclaimer&&) = delete;
       reclaimer& operator=(reclaimer&&) = delete;
-     ~reclaimer() { reclaim(); }
- 
    };
 
    // Deleter Implementation
@@ -98,21 +405,21 @@ namespace gp {
     class deleter {
        public:
        void operator()(T* data) {
-           delete data;
+           dispose_block(data);
        }
 
        void operator()(const T* data) {
-           delete data;
+           dispose_block(const_cast<T*>(data));
        } 
 
        static void retire(T* data) {
          if(data != nullptr)
-            delete data;
+            dispose_block(data);
        }
        
        static void retire(const T* data) {
          if(data != nullptr)
-            delete data;
+            dispose_block(const_cast<T*>(data));
        }      
    };
 
@@ -122,19 +429,39 @@ namespace gp {
    {
      // Only one member variable ie. the control block 
      private : 
+     using counter_ops = ref_count_ops<ref_counter>;
      control_block<T, ref_counter>* cb;
 
+     template <typename U, typename counter, template<typename> typename manager>
+     friend class atomic_shared_ptr;
+
      public:
-     _shared_ptr_(T& data)  : cb(new control_block<T, ref_counter>((std::move(data)))) {}
+     _shared_ptr_(const T& data) : cb(new control_block<T, ref_counter>(data)) {}
      _shared_ptr_(T&& data) : cb(new control_block<T, ref_counter>((std::move(data)))) {}     
 
-     _shared_ptr_(const _shared_ptr_& other) : cb(other.cb) { ++(cb->ref_count); }
+     /// Adopts a control block whose reference is already counted (see gp::allocate_shared)
+     explicit _shared_ptr_(control_block<T, ref_counter>* block) : cb(block) {}
+
+     _shared_ptr_(const _shared_ptr_& other) : cb(other.cb) { if(cb != nullptr) counter_ops::increment(cb->ref_count); }
+
+     /// Steals the control block, no reference count traffic
+     _shared_ptr_(_shared_ptr_&& other) noexcept : cb(other.cb) { other.cb = nullptr; }
     
      _shared_ptr_& operator=(const _shared_ptr_& other) {
         if (this != &other) {
             retire();
             cb = other.cb;
-            ++cb->ref_count;
+            if(cb != nullptr)
+               counter_ops::increment(cb->ref_count);
+        }
+        return *this;
+     }
+
+     _shared_ptr_& operator=(_shared_ptr_&& other) noexcept {
+        if (this != &other) {
+            retire();
+            cb = other.cb;
+            other.cb = nullptr;
         }
         return *this;
      }
@@ -144,7 +471,7 @@ namespace gp {
      }
     
      const bool is_null() const {
-        return cb->data == nullptr;
+        return cb == nullptr || cb->data == nullptr;
      }
     
      bool is_null_throw() {
@@ -165,11 +492,11 @@ namespace gp {
      }
 
      const int use_count() const {
-        return cb->ref_count;
+        return cb == nullptr ? 0 : counter_ops::use_count(cb->ref_count);
      }
 
      const bool unique() const {
-        return cb->ref_count == 1;
+        return use_count() == 1;
      }
 
      bool operator==(const _shared_ptr_& other) {
@@ -181,7 +508,7 @@ namespace gp {
      }
 
      bool operator==(const T* other) {
-        return cb->data == other;
+        return (cb == nullptr ? nullptr : cb->data) == other;
      }
 
      bool operator!=(const T* other) {
@@ -189,15 +516,15 @@ namespace gp {
      }
 
      bool operator==(const void* other) {
-        return static_cast<void*>(cb->data) == other;
+        return static_cast<void*>(cb == nullptr ? nullptr : cb->data) == other;
      }
 
-     void swap(_shared_ptr_& other) {
+     void swap(_shared_ptr_& other) noexcept {
         std::swap(cb, other.cb);
      }
 
      operator bool() {
-        return cb->data != nullptr;
+        return !is_null();
      }
 
      void reset() {
@@ -210,22 +537,213 @@ namespace gp {
         cb = new control_block<T, ref_counter>(std::move(data));
      }
  
+     /// Drops this reference, safe on an empty (reset or moved-from) pointer
      void retire() {
-        --cb->ref_count;
-        if((cb->ref_count) == 0)
+        if(cb == nullptr)
+           return;
+        if(counter_ops::decrement(cb->ref_count))
            memory_manager::retire(cb);
         cb = nullptr;
      }
 
      _shared_ptr_ copy_new_instance() {
-        if(cb->ref_count > 0) {
-            --cb->ref_count;
+        if(cb != nullptr && counter_ops::use_count(cb->ref_count) > 0) {
+            counter_ops::decrement(cb->ref_count);
             return _shared_ptr_(*cb->data);
         }
         throw std::runtime_error("Cannot copy new instance. The reference count is not greater than 0");
      }
 
 };
+
+   template <typename T, typename ref_counter, typename memory_manager>
+   void swap(_shared_ptr_<T, ref_counter, memory_manager>& lhs, _shared_ptr_<T, ref_counter, memory_manager>& rhs) noexcept
+   {
+      lhs.swap(rhs);
+   }
+
+   /// @brief Base for objects managed by gp::intrusive_ptr
+   /// The count lives in the object itself (same ref_counter policies as shared_ptr), so there is
+   /// no control block. Copying the object does not copy its count.
+   /// @tparam Derived The managed type (CRTP)
+   /// @tparam ref_counter The reference counter type (atomic(default), semi_atomic, biased_ref_counter, etc.)
+   template <typename Derived, typename ref_counter = atomic<uint32_t>>
+   class intrusive_ref_counted
+   {
+      public:
+      using ref_counter_type = ref_counter;
+
+      protected:
+      intrusive_ref_counted() : m_ref_count(0) { bind_counter(); }
+      intrusive_ref_counted(const intrusive_ref_counted&) : m_ref_count(0) { bind_counter(); }
+      intrusive_ref_counted& operator=(const intrusive_ref_counted&) { return *this; }
+     ~intrusive_ref_counted() = default;
+
+      private:
+      template <typename T, typename memory_manager>
+      friend class intrusive_ptr;
+
+      void bind_counter()
+      {
+         if constexpr (has_release_hook<ref_counter>::value)
+            m_ref_count.bind_release([](void* context) {
+               delete static_cast<Derived*>(static_cast<intrusive_ref_counted*>(context));
+            }, this);
+      }
+
+      mutable ref_counter m_ref_count;
+   };
+
+   /// @brief Shared pointer to an object that carries its own count (see intrusive_ref_counted)
+   /// @tparam T The type of the data, derived from intrusive_ref_counted<T, ...>
+   /// @tparam memory_manager Frees the object once the last reference is dropped
+   template <typename T, typename memory_manager = deleter<T>>
+   class intrusive_ptr
+   {
+     private:
+     using counter_ops = ref_count_ops<typename T::ref_counter_type>;
+     T* ptr;
+
+     public:
+     intrusive_ptr() noexcept : ptr(nullptr) {}
+
+     /// Takes a new reference to data
+     explicit intrusive_ptr(T* data) : ptr(data) { acquire(); }
+
+     intrusive_ptr(const intrusive_ptr& other) : ptr(other.ptr) { acquire(); }
+     intrusive_ptr(intrusive_ptr&& other) noexcept : ptr(other.ptr) { other.ptr = nullptr; }
+
+     intrusive_ptr& operator=(const intrusive_ptr& other) {
+        if (this != &other) {
+            retire();
+            ptr = other.ptr;
+            acquire();
+        }
+        return *this;
+     }
+
+     intrusive_ptr& operator=(intrusive_ptr&& other) noexcept {
+        if (this != &other) {
+            retire();
+            ptr = other.ptr;
+            other.ptr = nullptr;
+        }
+        return *this;
+     }
+
+     ~intrusive_ptr() {
+       retire();
+     }
+
+     T* get() const {
+        return ptr;
+     }
+
+     bool is_null() const {
+        return ptr == nullptr;
+     }
+
+     T* operator->() const {
+        if (is_null()) {
+            throw std::runtime_error("The intrusive pointer is null");
+        }
+        return ptr;
+     }
+
+     T& operator*() const {
+        return *operator->();
+     }
+
+     int use_count() const {
+        return ptr == nullptr ? 0 : counter_ops::use_count(count());
+     }
+
+     bool unique() const {
+        return use_count() == 1;
+     }
+
+     bool operator==(const intrusive_ptr& other) const {
+        return ptr == other.ptr;
+     }
+
+     bool operator!=(const intrusive_ptr& other) const {
+        return !(*this == other);
+     }
+
+     explicit operator bool() const {
+        return ptr != nullptr;
+     }
+
+     void swap(intrusive_ptr& other) noexcept {
+        std::swap(ptr, other.ptr);
+     }
+
+     void reset() {
+        retire();
+     }
+
+     void reset(T* data) {
+        intrusive_ptr(data).swap(*this);
+     }
+
+     /// Drops this reference, safe on an empty pointer
+     void retire() {
+        if(ptr == nullptr)
+           return;
+        if(counter_ops::decrement(count()))
+           memory_manager::retire(ptr);
+        ptr = nullptr;
+     }
+
+     private:
+     typename T::ref_counter_type& count() const {
+        return static_cast<const intrusive_ref_counted<T, typename T::ref_counter_type>*>(ptr)->m_ref_count;
+     }
+
+     void acquire() {
+        if(ptr != nullptr)
+           counter_ops::increment(count());
+     }
+   };
+
+   template <typename T, typename memory_manager>
+   void swap(intrusive_ptr<T, memory_manager>& lhs, intrusive_ptr<T, memory_manager>& rhs) noexcept
+   {
+      lhs.swap(rhs);
+   }
+
+   template <typename T, typename memory_manager = deleter<T>, typename... Args>
+   intrusive_ptr<T, memory_manager> make_intrusive(Args&&... args)
+   {
+      return intrusive_ptr<T, memory_manager>(new T(std::forward<Args>(args)...));
+   }
+
+   /// @brief Single allocation shared pointer: T is constructed inside its control block
+   /// alloc is rebound to the block type and kept in the block to free it. For pooled blocks pass
+   /// a HazardAllocator or a std::pmr::polymorphic_allocator over a gp::pool_resource.
+   template <typename T, typename ref_counter = uint32_t, template<typename> typename memory_manager = deleter, typename Alloc, typename... Args>
+   shared_ptr<T, ref_counter, memory_manager> allocate_shared(const Alloc& alloc, Args&&... args)
+   {
+      using block_type = inplace_control_block<T, ref_counter, Alloc>;
+      typename block_type::block_allocator block_alloc(alloc);
+      block_type* block = std::allocator_traits<typename block_type::block_allocator>::allocate(block_alloc, 1);
+      try
+      {
+         ::new (static_cast<void*>(block)) block_type(alloc, std::forward<Args>(args)...);
+      }
+      catch(...)
+      {
+         std::allocator_traits<typename block_type::block_allocator>::deallocate(block_alloc, block, 1);
+         throw;
+      }
+      return shared_ptr<T, ref_counter, memory_manager>(static_cast<control_block<T, ref_counter>*>(block));
+   }
+
+   template <typename T, typename ref_counter = uint32_t, template<typename> typename memory_manager = deleter, typename... Args>
+   shared_ptr<T, ref_counter, memory_manager> make_shared(Args&&... args)
+   {
+      return allocate_shared<T, ref_counter, memory_manager>(std::allocator<T>(), std::forward<Args>(args)...);
+   }
 } // namespace gp
 
 #endif